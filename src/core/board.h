@@ -5,6 +5,7 @@
 #ifndef DORY_BOARD_H
 #define DORY_BOARD_H
 
+#include <array>
 #include "chess.h"
 
 namespace Dory {
@@ -24,25 +25,79 @@ namespace Dory {
     template<bool isWhite>
     constexpr BB castleLongRookMove();
 
+    // Mailbox entries hold the piece type in the lower three bits and the color in bit 3
+    constexpr uint8_t MAILBOX_Black = 0b1000;
+    constexpr uint8_t MAILBOX_Empty = PIECE_None;
+
+    constexpr std::array<uint8_t, 64> EMPTY_MAILBOX = [] {
+        std::array<uint8_t, 64> mailbox{};
+        mailbox.fill(MAILBOX_Empty);
+        return mailbox;
+    }();
+
+    template<bool white>
+    constexpr uint8_t mailboxCode(Piece_t piece) {
+        if constexpr (white) return piece;
+        else return piece | MAILBOX_Black;
+    }
+
     struct RestoreInfo {
         uint8_t epSquare;
         uint8_t castling;
         Piece_t captured;
-        // Add halfmove counter etc
+        uint8_t halfmoveClock;
     };
 
     struct Board {
         BB wPawns{}, bPawns{}, wKnights{}, bKnights{}, wBishops{}, bBishops{}, wRooks{}, bRooks{}, wQueens{}, bQueens{};
         uint8_t wKingSq{}, bKingSq{}, enPassantSq{}, castling{}; // Optimization potential: merge (castling and ep) and king squares into same byte
+        uint8_t halfmoveClock{}; // plies since the last capture or pawn move, saturates at 255
+#ifdef DORY_MAILBOX
+        // Piece on every square, kept in sync with the bitboards by makeMove, unmakeMove and fork
+        std::array<uint8_t, 64> mailbox{EMPTY_MAILBOX};
+#endif
 
         Board() = default;
 
         constexpr Board(BB wP, BB bP, BB wN, BB bN, BB wB, BB bB, BB wR, BB bR, BB wQ, BB bQ, uint8_t wK, uint8_t bK,
-                        uint8_t ep, uint8_t cs) :
+                        uint8_t ep, uint8_t cs, uint8_t hm = 0) :
+                Board(BitboardsOnly{}, wP, bP, wN, bN, wB, bB, wR, bR, wQ, bQ, wK, bK, ep, cs) {
+            halfmoveClock = hm;
+            fillMailbox();
+        }
+
+    private:
+        // Leaves the mailbox empty, fork() copies it from the parent board instead
+        struct BitboardsOnly {};
+
+        constexpr Board(BitboardsOnly, BB wP, BB bP, BB wN, BB bN, BB wB, BB bB, BB wR, BB bR, BB wQ, BB bQ,
+                        uint8_t wK, uint8_t bK, uint8_t ep, uint8_t cs) :
                 wPawns{wP}, bPawns{bP}, wKnights{wN}, bKnights{bN}, wBishops{wB}, bBishops{bB},
                 wRooks{wR}, bRooks{bR}, wQueens{wQ}, bQueens{bQ}, wKingSq{wK}, bKingSq{bK}, enPassantSq{ep},
                 castling{cs} {}
 
+        template<bool whiteMoved, Piece_t piece, Flag_t flags>
+        [[nodiscard]] constexpr Board forkBitboards(BB from, BB to) const;
+
+        template<bool whiteMoved, Piece_t piece, Flag_t flags>
+        constexpr void mailboxMakeMove(int from, int to);
+
+        template<bool whiteMoved, Piece_t piece, Flag_t flags, Piece_t captured>
+        constexpr void mailboxUnmakeMove(int from, int to);
+
+    public:
+        constexpr void fillMailbox() {
+#ifdef DORY_MAILBOX
+            mailbox.fill(MAILBOX_Empty);
+            for (Piece_t piece: {PIECE_Queen, PIECE_Rook, PIECE_Bishop, PIECE_Knight, PIECE_Pawn}) {
+                for (BB bb = pieceBB<true>(piece); bb; bb &= bb - 1) mailbox[firstBitOf(bb)] = mailboxCode<true>(piece);
+                for (BB bb = pieceBB<false>(piece); bb; bb &= bb - 1) mailbox[firstBitOf(bb)] = mailboxCode<false>(piece);
+            }
+            mailbox[wKingSq] = mailboxCode<true>(PIECE_King);
+            mailbox[bKingSq] = mailboxCode<false>(PIECE_King);
+#endif
+        }
+
         template<bool whiteToMove>
         [[nodiscard]] constexpr BB pawns() const {
             if constexpr (whiteToMove) return wPawns; else return bPawns;
@@ -81,6 +136,26 @@ namespace Dory {
             return enPassantSq != 0;
         }
 
+        /**
+         * Neither side can mate: no pawns, rooks or queens and either at most one minor piece or only bishops that
+         * all stand on squares of one color.
+         */
+        [[nodiscard]] constexpr bool insufficientMaterial() const {
+            if (wPawns | bPawns | wRooks | bRooks | wQueens | bQueens) return false;
+            const BB minors = wKnights | bKnights | wBishops | bBishops;
+            if ((minors & (minors - 1)) == 0) return true;
+            constexpr BB darkSquares = 0xAA55AA55AA55AA55ull;
+            const BB bishops = wBishops | bBishops;
+            return minors == bishops && ((bishops & darkSquares) == 0 || (bishops & ~darkSquares) == 0);
+        }
+
+        /// Clock after a move of 'piece' to 'to', reset by pawn moves and captures
+        template<Piece_t piece>
+        [[nodiscard]] constexpr uint8_t nextHalfmoveClock(BB to) const {
+            if (piece == PIECE_Pawn || (to & occ())) return 0;
+            return halfmoveClock + (halfmoveClock < 255);
+        }
+
         template<bool whiteToMove>
         [[nodiscard]] constexpr BB enemyPawns() const { return pawns<!whiteToMove>(); }
 
@@ -139,6 +214,19 @@ namespace Dory {
             return 0;
         }
 
+        template<bool whiteToMove>
+        [[nodiscard]] constexpr BB pieceBB(Piece_t piece) const {
+            switch (piece) {
+                case PIECE_Pawn:    return pawns<whiteToMove>();
+                case PIECE_Knight:  return knights<whiteToMove>();
+                case PIECE_Bishop:  return bishops<whiteToMove>();
+                case PIECE_Rook:    return rooks<whiteToMove>();
+                case PIECE_Queen:   return queens<whiteToMove>();
+                case PIECE_King:    return king<whiteToMove>();
+                default:            return 0;
+            }
+        }
+
         template<bool whiteToMove>
         [[nodiscard]] constexpr BB allPieces() const {
             if constexpr (whiteToMove) return wPawns | wKnights | wBishops | wRooks | wQueens | newMask(wKingSq);
@@ -168,7 +256,12 @@ namespace Dory {
 
         template<bool whiteToMove>
         [[nodiscard]] constexpr bool isCapture(Move move) const {
+#ifdef DORY_MAILBOX
+            // the target square of a legal move never holds an own piece
+            return mailbox[move.toIndex] != MAILBOX_Empty;
+#else
             return hasBitAt(enemyPieces<whiteToMove>(), move.toIndex);
+#endif
         }
 
         template<bool whiteToMove>
@@ -189,14 +282,46 @@ namespace Dory {
             else return castling & bCastleMask;
         }
 
+        /**
+         * Type of the piece on the given square regardless of its color, PIECE_None for an empty square.
+         */
+        [[nodiscard]] constexpr Piece_t pieceAt(int sq) const {
+#ifdef DORY_MAILBOX
+            return mailbox[sq] & ~MAILBOX_Black;
+#else
+            BB mask = newMask(sq);
+            if (mask & (wPawns | bPawns)) return PIECE_Pawn;
+            else if (mask & (wKnights | bKnights)) return PIECE_Knight;
+            else if (mask & (wBishops | bBishops)) return PIECE_Bishop;
+            else if (mask & (wRooks | bRooks)) return PIECE_Rook;
+            else if (mask & (wQueens | bQueens)) return PIECE_Queen;
+            else if (sq == wKingSq || sq == bKingSq) return PIECE_King;
+            return PIECE_None;
+#endif
+        }
+
         template<bool whiteToMove>
         [[nodiscard]] constexpr Piece_t getPieceAt(BB sq) const {
+#ifdef DORY_MAILBOX
+            uint8_t code = mailbox[singleBitOf(sq)];
+            Piece_t piece = code & ~MAILBOX_Black;
+            if (code != mailboxCode<whiteToMove>(piece) || piece == PIECE_King) return PIECE_None;
+            return piece;
+#else
             if (sq & pawns<whiteToMove>()) return PIECE_Pawn;
             else if (sq & knights<whiteToMove>()) return PIECE_Knight;
             else if (sq & bishops<whiteToMove>()) return PIECE_Bishop;
             else if (sq & rooks<whiteToMove>()) return PIECE_Rook;
             else if (sq & queens<whiteToMove>()) return PIECE_Queen;
             return PIECE_None;
+#endif
+        }
+
+        /**
+         * Restores the full move from its packed form, the moving piece is looked up on this board.
+         */
+        [[nodiscard]] constexpr Move unpack(PackedMove move) const {
+            return {move.fromIndex(), move.toIndex(), pieceAt(move.fromIndex()), move.flags()};
         }
 
         template<bool whiteMoved, Piece_t piece, Flag_t flags = MOVEFLAG_Silent>
@@ -308,7 +433,7 @@ namespace Dory {
     // - - - - - - - - - Out-of-line definitions for Board - - - - - - - - -
 
     template<bool whiteMoved, Piece_t piece, Flag_t flags>
-    constexpr Board Board::fork(BB from, BB to) const {
+    constexpr Board Board::forkBitboards(BB from, BB to) const {
         BB change = from | to;
         uint8_t cs = castling;
 
@@ -327,49 +452,61 @@ namespace Dory {
         // Promotions
         if constexpr (flags == MOVEFLAG_PromoteQueen) {
             if constexpr (whiteMoved)
-                return {wPawns & ~from, bPawns, wKnights, bKnights & ~to, wBishops, bBishops & ~to, wRooks,
+                return {BitboardsOnly{},
+                        wPawns & ~from, bPawns, wKnights, bKnights & ~to, wBishops, bBishops & ~to, wRooks,
                         bRooks & ~to, wQueens | to, bQueens & ~to, wKingSq, bKingSq, 0, cs};
-            return {wPawns, bPawns & ~from, wKnights & ~to, bKnights, wBishops & ~to, bBishops, wRooks & ~to,
+            return {BitboardsOnly{},
+                    wPawns, bPawns & ~from, wKnights & ~to, bKnights, wBishops & ~to, bBishops, wRooks & ~to,
                     bRooks, wQueens & ~to, bQueens | to, wKingSq, bKingSq, 0, cs};
         }
         if constexpr (flags == MOVEFLAG_PromoteRook) {
             if constexpr (whiteMoved)
-                return {wPawns & ~from, bPawns, wKnights, bKnights & ~to, wBishops, bBishops & ~to, wRooks | to,
+                return {BitboardsOnly{},
+                        wPawns & ~from, bPawns, wKnights, bKnights & ~to, wBishops, bBishops & ~to, wRooks | to,
                         bRooks & ~to, wQueens, bQueens & ~to, wKingSq, bKingSq, 0, cs};
-            return {wPawns, bPawns & ~from, wKnights & ~to, bKnights, wBishops & ~to, bBishops, wRooks & ~to,
+            return {BitboardsOnly{},
+                    wPawns, bPawns & ~from, wKnights & ~to, bKnights, wBishops & ~to, bBishops, wRooks & ~to,
                     bRooks | to, wQueens & ~to, bQueens, wKingSq, bKingSq, 0, cs};
         }
         if constexpr (flags == MOVEFLAG_PromoteBishop) {
             if constexpr (whiteMoved)
-                return {wPawns & ~from, bPawns, wKnights, bKnights & ~to, wBishops | to, bBishops & ~to, wRooks,
+                return {BitboardsOnly{},
+                        wPawns & ~from, bPawns, wKnights, bKnights & ~to, wBishops | to, bBishops & ~to, wRooks,
                         bRooks & ~to, wQueens, bQueens & ~to, wKingSq, bKingSq, 0, cs};
-            return {wPawns, bPawns & ~from, wKnights & ~to, bKnights, wBishops & ~to, bBishops | to, wRooks & ~to,
+            return {BitboardsOnly{},
+                    wPawns, bPawns & ~from, wKnights & ~to, bKnights, wBishops & ~to, bBishops | to, wRooks & ~to,
                     bRooks, wQueens & ~to, bQueens, wKingSq, bKingSq, 0, cs};
         }
         if constexpr (flags == MOVEFLAG_PromoteKnight) {
             if constexpr (whiteMoved)
-                return {wPawns & ~from, bPawns, wKnights | to, bKnights & ~to, wBishops, bBishops & ~to, wRooks,
+                return {BitboardsOnly{},
+                        wPawns & ~from, bPawns, wKnights | to, bKnights & ~to, wBishops, bBishops & ~to, wRooks,
                         bRooks & ~to, wQueens, bQueens & ~to, wKingSq, bKingSq, 0, cs};
-            return {wPawns, bPawns & ~from, wKnights & ~to, bKnights | to, wBishops & ~to, bBishops, wRooks & ~to,
+            return {BitboardsOnly{},
+                    wPawns, bPawns & ~from, wKnights & ~to, bKnights | to, wBishops & ~to, bBishops, wRooks & ~to,
                     bRooks, wQueens & ~to, bQueens, wKingSq, bKingSq, 0, cs};
         }
 
         // Castles
         if constexpr (flags == MOVEFLAG_ShortCastling) {
             if constexpr (whiteMoved)
-                return {wPawns, bPawns, wKnights, bKnights, wBishops, bBishops,
+                return {BitboardsOnly{},
+                        wPawns, bPawns, wKnights, bKnights, wBishops, bBishops,
                         wRooks ^ castleShortRookMove<whiteMoved>(), bRooks, wQueens, bQueens,
                         static_cast<uint8_t>(singleBitOf(to)), bKingSq, 0, cs};
-            return {wPawns, bPawns, wKnights, bKnights, wBishops, bBishops, wRooks,
+            return {BitboardsOnly{},
+                    wPawns, bPawns, wKnights, bKnights, wBishops, bBishops, wRooks,
                     bRooks ^ castleShortRookMove<whiteMoved>(), wQueens, bQueens, wKingSq,
                     static_cast<uint8_t>(singleBitOf(to)), 0, cs};
         }
         if constexpr (flags == MOVEFLAG_LongCastling) {
             if constexpr (whiteMoved)
-                return {wPawns, bPawns, wKnights, bKnights, wBishops, bBishops,
+                return {BitboardsOnly{},
+                        wPawns, bPawns, wKnights, bKnights, wBishops, bBishops,
                         wRooks ^ castleLongRookMove<whiteMoved>(), bRooks, wQueens, bQueens,
                         static_cast<uint8_t>(singleBitOf(to)), bKingSq, 0, cs};
-            return {wPawns, bPawns, wKnights, bKnights, wBishops, bBishops, wRooks,
+            return {BitboardsOnly{},
+                    wPawns, bPawns, wKnights, bKnights, wBishops, bBishops, wRooks,
                     bRooks ^ castleLongRookMove<whiteMoved>(), wQueens, bQueens, wKingSq,
                     static_cast<uint8_t>(singleBitOf(to)), 0, cs};
         }
@@ -379,50 +516,73 @@ namespace Dory {
             BB epMask = flags == MOVEFLAG_EnPassantCapture ? ~backward<whiteMoved>(newMask(enPassantSq)) : FULL_BB;
             uint8_t epField = flags == MOVEFLAG_PawnDoublePush ? singleBitOf(forward<whiteMoved>(from)) : 0;
             if constexpr (whiteMoved)
-                return {wPawns ^ change, bPawns & epMask & ~to, wKnights, bKnights & ~to, wBishops, bBishops & ~to,
+                return {BitboardsOnly{},
+                        wPawns ^ change, bPawns & epMask & ~to, wKnights, bKnights & ~to, wBishops, bBishops & ~to,
                         wRooks, bRooks & ~to, wQueens, bQueens & ~to, wKingSq, bKingSq, epField, cs};
-            return {wPawns & epMask & ~to, bPawns ^ change, wKnights & ~to, bKnights, wBishops & ~to, bBishops,
+            return {BitboardsOnly{},
+                    wPawns & epMask & ~to, bPawns ^ change, wKnights & ~to, bKnights, wBishops & ~to, bBishops,
                     wRooks & ~to, bRooks, wQueens & ~to, bQueens, wKingSq, bKingSq, epField, cs};
         }
         if constexpr (piece == PIECE_Knight) {
             if constexpr (whiteMoved)
-                return {wPawns, bPawns & ~to, wKnights ^ change, bKnights & ~to, wBishops, bBishops & ~to, wRooks,
+                return {BitboardsOnly{},
+                        wPawns, bPawns & ~to, wKnights ^ change, bKnights & ~to, wBishops, bBishops & ~to, wRooks,
                         bRooks & ~to, wQueens, bQueens & ~to, wKingSq, bKingSq, 0, cs};
-            return {wPawns & ~to, bPawns, wKnights & ~to, bKnights ^ change, wBishops & ~to, bBishops, wRooks & ~to,
+            return {BitboardsOnly{},
+                    wPawns & ~to, bPawns, wKnights & ~to, bKnights ^ change, wBishops & ~to, bBishops, wRooks & ~to,
                     bRooks, wQueens & ~to, bQueens, wKingSq, bKingSq, 0, cs};
         }
         if constexpr (piece == PIECE_Bishop) {
             if constexpr (whiteMoved)
-                return {wPawns, bPawns & ~to, wKnights, bKnights & ~to, wBishops ^ change, bBishops & ~to, wRooks,
+                return {BitboardsOnly{},
+                        wPawns, bPawns & ~to, wKnights, bKnights & ~to, wBishops ^ change, bBishops & ~to, wRooks,
                         bRooks & ~to, wQueens, bQueens & ~to, wKingSq, bKingSq, 0, cs};
-            return {wPawns & ~to, bPawns, wKnights & ~to, bKnights, wBishops & ~to, bBishops ^ change, wRooks & ~to,
+            return {BitboardsOnly{},
+                    wPawns & ~to, bPawns, wKnights & ~to, bKnights, wBishops & ~to, bBishops ^ change, wRooks & ~to,
                     bRooks, wQueens & ~to, bQueens, wKingSq, bKingSq, 0, cs};
         }
         if constexpr (piece == PIECE_Rook) {
             if constexpr (whiteMoved)
-                return {wPawns, bPawns & ~to, wKnights, bKnights & ~to, wBishops, bBishops & ~to, wRooks ^ change,
+                return {BitboardsOnly{},
+                        wPawns, bPawns & ~to, wKnights, bKnights & ~to, wBishops, bBishops & ~to, wRooks ^ change,
                         bRooks & ~to, wQueens, bQueens & ~to, wKingSq, bKingSq, 0, cs};
-            return {wPawns & ~to, bPawns, wKnights & ~to, bKnights, wBishops & ~to, bBishops, wRooks & ~to,
+            return {BitboardsOnly{},
+                    wPawns & ~to, bPawns, wKnights & ~to, bKnights, wBishops & ~to, bBishops, wRooks & ~to,
                     bRooks ^ change, wQueens & ~to, bQueens, wKingSq, bKingSq, 0, cs};
         }
         if constexpr (piece == PIECE_Queen) {
             if constexpr (whiteMoved)
-                return {wPawns, bPawns & ~to, wKnights, bKnights & ~to, wBishops, bBishops & ~to, wRooks,
+                return {BitboardsOnly{},
+                        wPawns, bPawns & ~to, wKnights, bKnights & ~to, wBishops, bBishops & ~to, wRooks,
                         bRooks & ~to, wQueens ^ change, bQueens & ~to, wKingSq, bKingSq, 0, cs};
-            return {wPawns & ~to, bPawns, wKnights & ~to, bKnights, wBishops & ~to, bBishops, wRooks & ~to, bRooks,
+            return {BitboardsOnly{},
+                    wPawns & ~to, bPawns, wKnights & ~to, bKnights, wBishops & ~to, bBishops, wRooks & ~to, bRooks,
                     wQueens & ~to, bQueens ^ change, wKingSq, bKingSq, 0, cs};
         }
         if constexpr (piece == PIECE_King) {
             if constexpr (whiteMoved)
-                return {wPawns, bPawns & ~to, wKnights, bKnights & ~to, wBishops, bBishops & ~to, wRooks,
+                return {BitboardsOnly{},
+                        wPawns, bPawns & ~to, wKnights, bKnights & ~to, wBishops, bBishops & ~to, wRooks,
                         bRooks & ~to, wQueens, bQueens & ~to, static_cast<uint8_t>(singleBitOf(to)), bKingSq, 0,
                         cs};
-            return {wPawns & ~to, bPawns, wKnights & ~to, bKnights, wBishops & ~to, bBishops, wRooks & ~to, bRooks,
+            return {BitboardsOnly{},
+                    wPawns & ~to, bPawns, wKnights & ~to, bKnights, wBishops & ~to, bBishops, wRooks & ~to, bRooks,
                     wQueens & ~to, bQueens, wKingSq, static_cast<uint8_t>(singleBitOf(to)), 0, cs};
         }
 //            throw std::exception();
     }
 
+    template<bool whiteMoved, Piece_t piece, Flag_t flags>
+    constexpr Board Board::fork(BB from, BB to) const {
+        Board next = forkBitboards<whiteMoved, piece, flags>(from, to);
+        next.halfmoveClock = nextHalfmoveClock<piece>(to);
+#ifdef DORY_MAILBOX
+        next.mailbox = mailbox;
+        next.mailboxMakeMove<whiteMoved, piece, flags>(singleBitOf(from), singleBitOf(to));
+#endif
+        return next;
+    }
+
     template<bool whiteToMove>
     constexpr Board Board::fork(const Move &move) const {
         switch (move.piece) {
@@ -481,10 +641,53 @@ namespace Dory {
         }
     }
 
+    template<bool whiteMoved, Piece_t piece, Flag_t flags>
+    constexpr void Board::mailboxMakeMove([[maybe_unused]] int from, [[maybe_unused]] int to) {
+#ifdef DORY_MAILBOX
+        constexpr Piece_t placed = flags == MOVEFLAG_PromoteQueen ? PIECE_Queen
+                                 : flags == MOVEFLAG_PromoteRook ? PIECE_Rook
+                                 : flags == MOVEFLAG_PromoteBishop ? PIECE_Bishop
+                                 : flags == MOVEFLAG_PromoteKnight ? PIECE_Knight
+                                 : piece;
+        mailbox[from] = MAILBOX_Empty;
+        mailbox[to] = mailboxCode<whiteMoved>(placed);
+
+        if constexpr (flags == MOVEFLAG_EnPassantCapture) {
+            mailbox[whiteMoved ? to - 8 : to + 8] = MAILBOX_Empty;
+        } else if constexpr (flags == MOVEFLAG_ShortCastling) {
+            mailbox[to + 1] = MAILBOX_Empty;
+            mailbox[to - 1] = mailboxCode<whiteMoved>(PIECE_Rook);
+        } else if constexpr (flags == MOVEFLAG_LongCastling) {
+            mailbox[to - 2] = MAILBOX_Empty;
+            mailbox[to + 1] = mailboxCode<whiteMoved>(PIECE_Rook);
+        }
+#endif
+    }
+
+    template<bool whiteMoved, Piece_t piece, Flag_t flags, Piece_t captured>
+    constexpr void Board::mailboxUnmakeMove([[maybe_unused]] int from, [[maybe_unused]] int to) {
+#ifdef DORY_MAILBOX
+        mailbox[from] = mailboxCode<whiteMoved>(piece);
+        mailbox[to] = captured == PIECE_None ? MAILBOX_Empty : mailboxCode<!whiteMoved>(captured);
+
+        if constexpr (flags == MOVEFLAG_EnPassantCapture) {
+            mailbox[whiteMoved ? to - 8 : to + 8] = mailboxCode<!whiteMoved>(PIECE_Pawn);
+        } else if constexpr (flags == MOVEFLAG_ShortCastling) {
+            mailbox[to - 1] = MAILBOX_Empty;
+            mailbox[to + 1] = mailboxCode<whiteMoved>(PIECE_Rook);
+        } else if constexpr (flags == MOVEFLAG_LongCastling) {
+            mailbox[to + 1] = MAILBOX_Empty;
+            mailbox[to - 2] = mailboxCode<whiteMoved>(PIECE_Rook);
+        }
+#endif
+    }
+
     template<bool whiteMoved, Piece_t piece, Flag_t flags>
     RestoreInfo Board::makeMove(BB from, BB to) {
         BB change = from | to;
-        RestoreInfo ri{enPassantSq, castling, getPieceAt<!whiteMoved>(to)};
+        RestoreInfo ri{enPassantSq, castling, getPieceAt<!whiteMoved>(to), halfmoveClock};
+        halfmoveClock = nextHalfmoveClock<piece>(to);
+        mailboxMakeMove<whiteMoved, piece, flags>(singleBitOf(from), singleBitOf(to));
 
         int epSq = enPassantSq;
         enPassantSq = flags == MOVEFLAG_PawnDoublePush ? singleBitOf(forward<whiteMoved>(from)) : 0;
@@ -767,6 +970,8 @@ namespace Dory {
         BB change = from | to;
         enPassantSq = ri.epSquare;
         castling = ri.castling;
+        halfmoveClock = ri.halfmoveClock;
+        mailboxUnmakeMove<whiteMoved, piece, flags, captured>(singleBitOf(from), singleBitOf(to));
 
         // Promotions
         if constexpr (flags == MOVEFLAG_PromoteQueen) {
@@ -35,6 +35,9 @@ namespace Dory {
 
         template<bool>
         static void reload(const Board &board, PinData& pd);
+
+        template<bool, PieceSteps::SliderImpl>
+        static void reload(const Board &board, PinData& pd);
     };
 
     template<bool whiteToMove, int dir>
@@ -89,6 +92,11 @@ namespace Dory {
     }
 
     template<bool whiteToMove>
+    void CheckLogicHandler::reload(const Board &board, PinData& pd) {
+        PieceSteps::withSliderImpl([&]<PieceSteps::SliderImpl impl>() { reload<whiteToMove, impl>(board, pd); });
+    }
+
+    template<bool whiteToMove, PieceSteps::SliderImpl impl>
     void CheckLogicHandler::reload(const Board &board, PinData& pd) {
         int kingSquare = board.kingSquare<whiteToMove>();
 
@@ -149,7 +157,7 @@ namespace Dory {
         BB pieces = bishopBB | queenBB;
         Bitloop(pieces) {
             int ix = firstBitOf(pieces);
-            mask = PieceSteps::slideMask<true>(occ, ix);
+            mask = PieceSteps::slideMask<true, impl>(occ, ix);
             pd.attacked |= mask;
             if(mask & myKing) pd.checkMask &= PieceSteps::FROM_TO[kingSquare][ix];
 
@@ -162,7 +170,7 @@ namespace Dory {
         pieces = rookBB | queenBB;
         Bitloop(pieces) {
             int ix = firstBitOf(pieces);
-            mask = PieceSteps::slideMask<false>(occ, ix);
+            mask = PieceSteps::slideMask<false, impl>(occ, ix);
             pd.attacked |= mask;
             if(mask & myKing) pd.checkMask &= PieceSteps::FROM_TO[kingSquare][ix];
 
@@ -12,7 +12,7 @@
 
 namespace Dory {
 
-    #define Bitloop(X) for(;X; X = _blsr_u64(X))
+    #define Bitloop(X) for(;X; X &= X - 1) // BLSR where BMI1 is available
 
     using BB = uint64_t;
     using square = uint64_t;
@@ -130,8 +130,8 @@ namespace Dory {
     }
 
     static inline BB isolateLowestBit(BB number) {
-        // calculates number & -number;
-        return _blsi_u64(number);
+        // compiles to BLSI where BMI1 is available
+        return number & (0 - number);
     }
 
     // ------------- PAWN MOVES -------------
@@ -262,6 +262,33 @@ namespace Dory {
 
     constexpr static const Move NULLMOVE{0, 0, 0, 0};
 
+    /**
+     * Two byte encoding of a move (6 bits from, 6 bits to, 4 bits flags) for the search tables.
+     * The moving piece is not stored, Board::unpack() reads it from the board the move is played on.
+     */
+    struct PackedMove {
+        uint16_t bits{0};
+
+        constexpr PackedMove() = default;
+
+        constexpr PackedMove(uint8_t fromIx, uint8_t toIx, Flag_t fl)
+            : bits{static_cast<uint16_t>(fromIx | (toIx << 6) | (fl << 12))} {}
+
+        constexpr explicit PackedMove(const Move& move) : PackedMove(move.fromIndex, move.toIndex, move.flags) {}
+
+        [[nodiscard]] constexpr uint8_t fromIndex() const { return bits & 0x3f; }
+
+        [[nodiscard]] constexpr uint8_t toIndex() const { return (bits >> 6) & 0x3f; }
+
+        [[nodiscard]] constexpr Flag_t flags() const { return bits >> 12; }
+
+        [[nodiscard]] constexpr bool isNull() const { return bits == 0; }
+
+        bool operator==(const PackedMove &other) const = default;
+    };
+
+    constexpr static const PackedMove NULLPACKEDMOVE{};
+
 } // namespace Dory
 
 #endif //DORY_CHESS_H
@@ -28,7 +28,7 @@ namespace Dory::MoveCollectors {
         using Generator = MoveGenerator<LimitedDFS<depth>>;
         friend Generator;
     public:
-        static unsigned long long totalNodes;
+        static thread_local unsigned long long totalNodes;
 
         template<bool whiteToMove>
         static inline void generateGameTree(Board& board) {
@@ -53,7 +53,7 @@ namespace Dory::MoveCollectors {
     };
 
     template<int depth>
-    unsigned long long LimitedDFS<depth>::totalNodes{0};
+    thread_local unsigned long long LimitedDFS<depth>::totalNodes{0};
 
 
 //    struct QuickCollector {
@@ -77,7 +77,7 @@ namespace Dory::MoveCollectors {
 
     template<typename T>
     class ObjectCollector {
-        static T* _ref;
+        static thread_local T* _ref;
 
         template<bool whiteToMove, Piece_t piece, Flag_t flags = MOVEFLAG_Silent>
         static inline void nextMove(Board& board, BB from, BB to) {
@@ -100,7 +100,7 @@ namespace Dory::MoveCollectors {
     };
 
     template<typename T>
-    T* ObjectCollector<T>::_ref = nullptr;
+    thread_local T* ObjectCollector<T>::_ref = nullptr;
 
     template<typename T, bool whiteToMove, GenerationConfig config=GC_DEFAULT>
     inline void generateMoves(T* ref, Board& board) {
@@ -112,6 +112,35 @@ namespace Dory::MoveCollectors {
         ObjectCollector<T>::template generate<whiteToMove, config>(ref, board, pd);
     }
 
+    /**
+     * Collects all legal moves of a position into a fixed buffer. The pin data of the last generation tells
+     * whether the side to move is in check, which distinguishes checkmate from stalemate.
+     */
+    struct MoveList {
+        std::array<Move, 256> moves;
+        size_t count{0};
+        PinData pd;
+
+        template<bool whiteToMove, Piece_t piece, Flag_t flags = MOVEFLAG_Silent>
+        void nextMove([[maybe_unused]] Board& board, BB from, BB to) {
+            moves[count++] = createMoveFromBB(from, to, piece, flags);
+        }
+
+        template<bool whiteToMove>
+        void generate(Board& board) {
+            count = 0;
+            generateMoves<MoveList, whiteToMove>(this, board, pd);
+        }
+
+        void generate(Board& board, bool whiteToMove) {
+            if (whiteToMove) generate<true>(board);
+            else generate<false>(board);
+        }
+
+        [[nodiscard]] auto begin() const { return moves.begin(); }
+        [[nodiscard]] auto end() const { return moves.begin() + count; }
+    };
+
 //    Example for using class as MoveCollector
 //    struct A {
 //        template<bool whiteToMove, Piece_t piece, Flag_t flags = MOVEFLAG_Silent>
@@ -126,7 +155,7 @@ namespace Dory::MoveCollectors {
 //    };
 
 
-    static std::vector<unsigned long long> nodes;
+    static thread_local std::vector<unsigned long long> nodes;
 
     template<int depth>
     class PerftCollector {
@@ -32,8 +32,8 @@ namespace Dory {
     template<typename Collector>
     class MoveGenerator {
     public:
-        static PinData m_pd;
-        static unsigned long numberOfMoves;
+        static thread_local PinData m_pd;
+        static thread_local unsigned long numberOfMoves;
 
         MoveGenerator() = delete;
 
@@ -44,6 +44,9 @@ namespace Dory {
         static void generate(Board &board);
 
     private:
+        template<bool whiteToMove, GenerationConfig config, PieceSteps::SliderImpl impl>
+        static void generate(Board &board, PinData& pd);
+
         template<bool whiteToMove, GenerationConfig config, Piece_t piece, Flag_t flags = MOVEFLAG_Silent>
         static void generateSuccessorBoard(Board &board, BB from, BB to)
         requires ValidMoveCollector<Collector, whiteToMove, piece, flags>;
@@ -64,13 +67,13 @@ namespace Dory {
         template<bool whiteToMove, GenerationConfig config>
         static void knightMoves(Board &board, PinData& pd);
 
-        template<bool whiteToMove, GenerationConfig config>
+        template<bool whiteToMove, GenerationConfig config, PieceSteps::SliderImpl impl>
         static void bishopMoves(Board &board, PinData& pd, BB occ);
 
-        template<bool whiteToMove, GenerationConfig config>
+        template<bool whiteToMove, GenerationConfig config, PieceSteps::SliderImpl impl>
         static void rookMoves(Board &board, PinData& pd, BB occ);
 
-        template<bool whiteToMove, GenerationConfig config>
+        template<bool whiteToMove, GenerationConfig config, PieceSteps::SliderImpl impl>
         static void queenMoves(Board &board, PinData& pd, BB occ);
 
         template<bool whiteToMove, GenerationConfig config>
@@ -82,9 +85,15 @@ namespace Dory {
 
     template<typename Collector>
     template<bool whiteToMove, GenerationConfig config>
+    void MoveGenerator<Collector>::generate(Board &board, PinData& pd) {
+        PieceSteps::withSliderImpl([&]<PieceSteps::SliderImpl impl>() { generate<whiteToMove, config, impl>(board, pd); });
+    }
+
+    template<typename Collector>
+    template<bool whiteToMove, GenerationConfig config, PieceSteps::SliderImpl impl>
     void MoveGenerator<Collector>::generate(Board &board, PinData& pd) {
         if constexpr (config.reloadClh)
-            CheckLogicHandler::reload<whiteToMove>(board, pd);
+            CheckLogicHandler::reload<whiteToMove, impl>(board, pd);
 
         if constexpr (config.countOnly) {
             numberOfMoves = 0;
@@ -94,9 +103,9 @@ namespace Dory {
             BB occ = board.occ();
             pawnMoves<whiteToMove, config>(board, pd);
             knightMoves<whiteToMove, config>(board, pd);
-            bishopMoves<whiteToMove, config>(board, pd, occ);
-            rookMoves<whiteToMove, config>(board, pd, occ);
-            queenMoves<whiteToMove, config>(board, pd, occ);
+            bishopMoves<whiteToMove, config, impl>(board, pd, occ);
+            rookMoves<whiteToMove, config, impl>(board, pd, occ);
+            queenMoves<whiteToMove, config, impl>(board, pd, occ);
 
             if (board.canCastle<whiteToMove>() && !pd.inCheck())
                 castles<whiteToMove, config>(board, pd, occ);
@@ -293,27 +302,27 @@ namespace Dory {
     }
 
     template<typename Collector>
-    template<bool whiteToMove, GenerationConfig config>
+    template<bool whiteToMove, GenerationConfig config, PieceSteps::SliderImpl impl>
     void MoveGenerator<Collector>::bishopMoves(Board &board, PinData& pd, BB occ) {
         BB bishops = board.bishops<whiteToMove>() & ~pd.pinsStr;
 
         Bitloop(bishops) {
             int ix = firstBitOf(bishops);
-            BB targets = PieceSteps::slideMask<true>(occ, ix) & pd.targetSquares;
+            BB targets = PieceSteps::slideMask<true, impl>(occ, ix) & pd.targetSquares;
             if (hasBitAt(pd.pinsDiag, ix)) targets &= pd.pinsDiag;
             addToList<whiteToMove, config, PIECE_Bishop>(board, ix, targets);
         }
     }
 
     template<typename Collector>
-    template<bool whiteToMove, GenerationConfig config>
+    template<bool whiteToMove, GenerationConfig config, PieceSteps::SliderImpl impl>
     void MoveGenerator<Collector>::rookMoves(Board &board, PinData& pd, BB occ) {
         BB rooks = board.rooks<whiteToMove>() & ~pd.pinsDiag;
 
         Bitloop(rooks) {
             int ix = firstBitOf(rooks);
 
-            BB targets = PieceSteps::slideMask<false>(occ, ix) & pd.targetSquares;
+            BB targets = PieceSteps::slideMask<false, impl>(occ, ix) & pd.targetSquares;
             if (hasBitAt(pd.pinsStr, ix)) targets &= pd.pinsStr;
 
             if (board.canCastleShort<whiteToMove>() && hasBitAt(startingKingsideRook<whiteToMove>(), ix)) {
@@ -332,7 +341,7 @@ namespace Dory {
     }
 
     template<typename Collector>
-    template<bool whiteToMove, GenerationConfig config>
+    template<bool whiteToMove, GenerationConfig config, PieceSteps::SliderImpl impl>
     void MoveGenerator<Collector>::queenMoves(Board &board, PinData& pd, BB occ) {
         BB queens = board.queens<whiteToMove>();
         BB queensPinStr = queens & pd.pinsStr & ~pd.pinsDiag;
@@ -341,20 +350,20 @@ namespace Dory {
 
         Bitloop(queensPinStr) {
             int ix = firstBitOf(queensPinStr);
-            BB targets = PieceSteps::slideMask<false>(occ, ix) & pd.targetSquares & pd.pinsStr;
+            BB targets = PieceSteps::slideMask<false, impl>(occ, ix) & pd.targetSquares & pd.pinsStr;
             addToList<whiteToMove, config, PIECE_Queen>(board, ix, targets);
         }
 
         Bitloop(queensPinDiag) {
             int ix = firstBitOf(queensPinDiag);
-            BB targets = PieceSteps::slideMask<true>(occ, ix) & pd.targetSquares & pd.pinsDiag;
+            BB targets = PieceSteps::slideMask<true, impl>(occ, ix) & pd.targetSquares & pd.pinsDiag;
             addToList<whiteToMove, config, PIECE_Queen>(board, ix, targets);
         }
 
         Bitloop(queensNoPin) {
             int ix = firstBitOf(queensNoPin);
-            BB targets = PieceSteps::slideMask<false>(occ, ix) & pd.targetSquares;
-            targets |= PieceSteps::slideMask<true>(occ, ix) & pd.targetSquares;
+            BB targets = PieceSteps::slideMask<false, impl>(occ, ix) & pd.targetSquares;
+            targets |= PieceSteps::slideMask<true, impl>(occ, ix) & pd.targetSquares;
             addToList<whiteToMove, config, PIECE_Queen>(board, ix, targets);
         }
     }
@@ -398,10 +407,10 @@ namespace Dory {
     }
 
     template<typename MC>
-    PinData MoveGenerator<MC>::m_pd{};
+    thread_local PinData MoveGenerator<MC>::m_pd{};
 
     template<typename MC>
-    unsigned long MoveGenerator<MC>::numberOfMoves{0};
+    thread_local unsigned long MoveGenerator<MC>::numberOfMoves{0};
 
 } // namespace Dory
 
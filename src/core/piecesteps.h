@@ -6,37 +6,28 @@
 #define DORY_PIECESTEPS_H
 
 #include <array>
+#include <cstring>
+#include <utility>
+#include <string_view>
+#include <cpuid.h>
 #include "chess.h"
 
 namespace Dory::PieceSteps {
 
     // used to terminate arrays that represent list of squares
-    const uint8_t END_OF_ARRAY = 0x7f;
+    constexpr uint8_t END_OF_ARRAY = 0x7f;
 
     constexpr std::array<int, 8> directions{8, 9, 1, -7, -8, -9, -1, 7};
     constexpr std::array<int, 4> diagonal{1, 3, 5, 7}, straight{0, 2, 4, 6};
     constexpr int DIR_LEFT = 6, DIR_RIGHT = 2;
 
-    std::array<std::array<BB, 8>, 64> LINES{};
+    // All tables below are computed by the compiler and end up in the read-only data segment,
+    // so there is nothing to initialize at startup.
 
-    std::array<std::array<BB, 64>, 64> FROM_TO{};
-
-    std::array<std::array<uint8_t, 64>, 64> DIST{};
-
-    template<bool>
-    std::array<BB, 64> PASSED_PAWN_MASK{};
-
-    template<bool>
-    std::array<std::array<std::array<uint8_t, 8>, 4>, 64> STEPS{};
-
-    std::array<BB, 64> KNIGHT_MOVES{}, KING_MOVES{};
-
-    bool loaded{false};
-
-    int manhattan(int x1, int y1, int x2, int y2) {
-        return abs(x2 - x1) + abs(y2 - y1);
+    constexpr int manhattan(int x1, int y1, int x2, int y2) {
+        return (x2 > x1 ? x2 - x1 : x1 - x2) + (y2 > y1 ? y2 - y1 : y1 - y2);
     }
-    int manhattan(int index1, int index2) {
+    constexpr int manhattan(int index1, int index2) {
         return manhattan(
             fileOf(index1),
             rankOf(index1),
@@ -46,7 +37,12 @@ namespace Dory::PieceSteps {
     }
 
     template<bool diag>
-    void calculate_lines(int i) {
+    constexpr void calculate_lines(
+            int i,
+            std::array<std::array<BB, 8>, 64>& lines,
+            std::array<std::array<BB, 64>, 64>& fromTo,
+            std::array<std::array<std::array<uint8_t, 8>, 4>, 64>& steps
+    ) {
         int j;
         int d{0}, x{0};
         int manhattan_dist = diag ? 2 : 1;
@@ -56,149 +52,341 @@ namespace Dory::PieceSteps {
             j = i + off;
             while(0 <= j && j < 64 && manhattan(j-off, j) == manhattan_dist){
                 board = withBit(board, j);
-                FROM_TO[i][j] = board;
-                STEPS<diag>[i][d][x++] = j;
+                fromTo[i][j] = board;
+                steps[i][d][x++] = j;
                 j += off;
             }
-            LINES[i][id] = board;
-            STEPS<diag>[i][d][x] = END_OF_ARRAY;
+            lines[i][id] = board;
+            steps[i][d][x] = END_OF_ARRAY;
             d++;
             x = 0;
         }
     }
 
-    void addKnightMoves(int index) {
-        BB board{0};
-        for(int off: std::array<int, 8>{-17, -15, -6, 10, 17, 15, 6, -10}) {
-            int to = index + off;
-            if(0 <= to && to < 64 && manhattan(index, to) == 3) {
-                setBit(board, to);
+    struct LineTables {
+        std::array<std::array<BB, 8>, 64> lines{};
+        std::array<std::array<BB, 64>, 64> fromTo{};
+        std::array<std::array<std::array<uint8_t, 8>, 4>, 64> diagonalSteps{}, straightSteps{};
+    };
+
+    constexpr LineTables load_lines() {
+        LineTables t{};
+        for(int i = 0; i < 64; i++) {
+            calculate_lines<true>(i, t.lines, t.fromTo, t.diagonalSteps);
+            calculate_lines<false>(i, t.lines, t.fromTo, t.straightSteps);
+        }
+        return t;
+    }
+
+    constexpr LineTables LINE_TABLES = load_lines();
+
+    constexpr const std::array<std::array<BB, 8>, 64>& LINES = LINE_TABLES.lines;
+
+    constexpr const std::array<std::array<BB, 64>, 64>& FROM_TO = LINE_TABLES.fromTo;
+
+    template<bool diag>
+    constexpr const std::array<std::array<std::array<uint8_t, 8>, 4>, 64>& STEPS =
+            diag ? LINE_TABLES.diagonalSteps : LINE_TABLES.straightSteps;
+
+    constexpr std::array<BB, 64> load_knight_moves() {
+        std::array<BB, 64> moves{};
+        for(int index = 0; index < 64; index++) {
+            for(int off: std::array<int, 8>{-17, -15, -6, 10, 17, 15, 6, -10}) {
+                int to = index + off;
+                if(0 <= to && to < 64 && manhattan(index, to) == 3) {
+                    setBit(moves[index], to);
+                }
             }
         }
-        KNIGHT_MOVES[index] = board;
+        return moves;
     }
 
-    void addKingMoves(int index) {
-        BB board{0};
-        for(int off: std::array<int, 8>{-9, -8, -7, -1, 1, 7, 8, 9}) {
-            int to = index + off;
-            if(0 <= to && to < 64 && manhattan(index, to) <= 2) {
-                setBit(board, to);
+    constexpr std::array<BB, 64> load_king_moves() {
+        std::array<BB, 64> moves{};
+        for(int index = 0; index < 64; index++) {
+            for(int off: std::array<int, 8>{-9, -8, -7, -1, 1, 7, 8, 9}) {
+                int to = index + off;
+                if(0 <= to && to < 64 && manhattan(index, to) <= 2) {
+                    setBit(moves[index], to);
+                }
             }
         }
-        KING_MOVES[index] = board;
+        return moves;
     }
 
+    constexpr std::array<BB, 64> KNIGHT_MOVES = load_knight_moves(), KING_MOVES = load_king_moves();
+
     template<bool whiteToMove>
-    void load_passed_pawn_mask(int square) {
-        if(hasBitAt(backRank<whiteToMove>(), square))
-            return;
-
-        BB mask{0};
-        BB pawn = newMask(square);
-        BB leftRight{0};
-        if(pawn & pawnCanGoLeft<whiteToMove>()) {
-            leftRight |= backward<whiteToMove>(pawnAtkLeft<whiteToMove>(pawn));
-        }
-        if(pawn & pawnCanGoRight<whiteToMove>()) {
-            leftRight |= backward<whiteToMove>(pawnAtkRight<whiteToMove>(pawn));
-        }
-        pawn |= leftRight;
+    constexpr std::array<BB, 64> load_passed_pawn_masks() {
+        std::array<BB, 64> masks{};
+        for(int square = 0; square < 64; square++) {
+            if(hasBitAt(backRank<whiteToMove>(), square))
+                continue;
+
+            BB mask{0};
+            BB pawn = newMask(square);
+            BB leftRight{0};
+            if(pawn & pawnCanGoLeft<whiteToMove>()) {
+                leftRight |= backward<whiteToMove>(pawnAtkLeft<whiteToMove>(pawn));
+            }
+            if(pawn & pawnCanGoRight<whiteToMove>()) {
+                leftRight |= backward<whiteToMove>(pawnAtkRight<whiteToMove>(pawn));
+            }
+            pawn |= leftRight;
 
-        while((pawn & backRank<!whiteToMove>()) == 0) {
-            pawn = forward<whiteToMove>(pawn);
-            mask |= pawn;
+            while((pawn & backRank<!whiteToMove>()) == 0) {
+                pawn = forward<whiteToMove>(pawn);
+                mask |= pawn;
+            }
+
+            masks[square] = mask;
         }
+        return masks;
+    }
 
-        PASSED_PAWN_MASK<whiteToMove>[square] = mask;
+    template<bool whiteToMove>
+    constexpr std::array<BB, 64> PASSED_PAWN_MASK = load_passed_pawn_masks<whiteToMove>();
+
+    constexpr std::array<std::array<uint8_t, 64>, 64> load_dist() {
+        std::array<std::array<uint8_t, 64>, 64> dist{};
+        for(int from = 0; from < 64; from++) {
+            for(int to = 0; to < 64; to++) {
+                dist[from][to] = manhattan(from, to);
+            }
+        }
+        return dist;
     }
 
+    constexpr std::array<std::array<uint8_t, 64>, 64> DIST = load_dist();
+
     template<bool diag>
-    BB slideMaskSlow(BB occ, int index) {
+    constexpr BB slideMaskSlow(BB occ, int index) {
         BB mask = 0ull;
-        for(auto line: STEPS<diag>.at(index)) {
-            for(uint8_t sq: line) {
-                if(sq == END_OF_ARRAY) break;
-                setBit(mask, sq);
-                if(hasBitAt(occ, sq)) break;
+        for(int id: diag ? diagonal : straight) {
+            BB ray = LINES[index][id];
+            BB blockers = ray & occ;
+            if(blockers) {
+                // cut the ray behind the first blocker
+                int first = directions[id] > 0 ? firstBitOf(blockers) : lastBitOf(blockers);
+                ray ^= LINES[first][id];
             }
+            mask |= ray;
         }
         return mask;
     }
 
-    std::array<BB, 107648> sliderAttackBB;
+    // - - - - - - Slider Attacks - - - - - -
+    // Attack sets of sliding pieces are looked up in a table indexed either with PEXT or with a fancy magic
+    // multiplication. PEXT is a single instruction on Intel and AMD Zen 3+, but microcoded and very slow on earlier
+    // AMD families and the Zen 1 based Hygon Dhyana, where magic bitboards win. Native builds pick the implementation
+    // at compile time. Portable builds (DORY_SLIDER_DISPATCH) target CPUs without BMI2 and probe the CPU at startup.
+    // The move generator and the check logic handler branch on the result once per call (withSliderImpl) and run
+    // code specialised for it, PEXT is emitted inline there. Only isolated lookups branch on every call.
+
+    enum class SliderImpl : uint8_t { Pext, Magic };
+
+#if defined(__BMI2__) && !defined(__znver1__) && !defined(__znver2__) && !defined(__bdver4__)
+    constexpr SliderImpl NATIVE_SLIDER_IMPL = SliderImpl::Pext;
+#else
+    constexpr SliderImpl NATIVE_SLIDER_IMPL = SliderImpl::Magic;
+#endif
+
+    bool pextAvailable() {
+#if defined(__BMI2__) || defined(DORY_SLIDER_DISPATCH)
+        __builtin_cpu_init(); // may run during static initialization
+        return __builtin_cpu_supports("bmi2");
+#else
+        return false;
+#endif
+    }
 
-    template<bool>
-    std::array<BB, 64> arrMask;
+    bool isHygon() {
+        unsigned int maxLeaf, vendor[3];
+        if (!__get_cpuid(0, &maxLeaf, &vendor[0], &vendor[2], &vendor[1])) return false;
+        return std::memcmp(vendor, "HygonGenuine", sizeof(vendor)) == 0;
+    }
 
-    std::array<int, 64> arrRookBase, arrBishopBase;
-    BB inside = ~(fileA | fileH | rank1 | rank8);
+    bool cpuHasFastPext() {
+        if (!pextAvailable()) return false;
+        if (!__builtin_cpu_is("amd") && !isHygon()) return true;
 
-    template<bool diag>
-    inline BB slideMask(BB occ, int sq) {
-        if constexpr (diag) {
-            return sliderAttackBB[arrBishopBase[sq] + _pext_u64(occ, arrMask<diag>[sq])];
-        } else {
-            return sliderAttackBB[arrRookBase[sq] + _pext_u64(occ, arrMask<diag>[sq])];
-        }
+        unsigned int eax, ebx, ecx, edx;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+        unsigned int family = ((eax >> 8) & 0xf) + ((eax >> 20) & 0xff);
+        return family >= 0x19;
     }
 
+#ifdef DORY_SLIDER_DISPATCH
+    SliderImpl sliderImpl{cpuHasFastPext() ? SliderImpl::Pext : SliderImpl::Magic};
+#else
+    SliderImpl sliderImpl{NATIVE_SLIDER_IMPL};
+#endif
+
     template<bool diag>
-    void handle_pext(int sq, int& offset) {
+    constexpr BB load_slider_mask(int sq) {
         BB fullMask = slideMaskSlow<diag>(0, sq);
         if(!hasBitAt(fileA, sq)) fullMask &= ~fileA;
         if(!hasBitAt(fileH, sq)) fullMask &= ~fileH;
         if(!hasBitAt(rank1, sq)) fullMask &= ~rank1;
         if(!hasBitAt(rank8, sq)) fullMask &= ~rank8;
+        return fullMask;
+    }
 
-        arrMask<diag>.at(sq) = fullMask;
-        int numOccupancies = 1 << bitCount(fullMask);
-        for (int cand = 0; cand < numOccupancies; ++cand) {
-            BB occ = 0, mask = fullMask, extractor = 1;
-            Bitloop(mask) {
-                if(cand & extractor) {
-                    occ |= isolateLowestBit(mask);
-                }
-                extractor <<= 1;
-            }
+    template<bool diag>
+    constexpr std::array<BB, 64> load_slider_masks() {
+        std::array<BB, 64> masks{};
+        for(int sq = 0; sq < 64; sq++) masks[sq] = load_slider_mask<diag>(sq);
+        return masks;
+    }
 
-            sliderAttackBB.at(offset + cand) = slideMaskSlow<diag>(occ, sq);
-        }
-        offset += numOccupancies;
+    template<bool diag>
+    constexpr std::array<BB, 64> arrMask = load_slider_masks<diag>();
+
+    template<bool diag>
+    constexpr std::array<uint8_t, 64> load_slider_shifts() {
+        std::array<uint8_t, 64> shifts{};
+        for(int sq = 0; sq < 64; sq++) shifts[sq] = 64 - bitCount(arrMask<diag>[sq]);
+        return shifts;
     }
 
-    void init_pext() {
-        int offset = 0;
-        for (int sq = 0; sq < 64; ++sq) {
-            arrRookBase.at(sq) = offset;
-            handle_pext<false>(sq, offset);
-            arrBishopBase.at(sq) = offset;
-            handle_pext<true>(sq, offset);
+    template<bool diag>
+    constexpr std::array<uint8_t, 64> arrShift = load_slider_shifts<diag>();
+
+    template<bool diag>
+    constexpr std::array<BB, 64> MAGICS = diag
+        ? std::array<BB, 64>{
+            0x8a02301111010200ull, 0x0160040410802020ull, 0x1890010218300000ull, 0x3044104204004020ull,
+            0x1041104008024813ull, 0x401082104000c003ull, 0x4004480411084000ull, 0x8000420814052400ull,
+            0x0000485010020251ull, 0x010c100411106200ull, 0x44804808004a9002ull, 0x2a05044040810044ull,
+            0x2000011040050410ull, 0x000006024a22005aull, 0x0000010090a42000ull, 0x400100404208200dull,
+            0x18110c241010a100ull, 0x1120800801014200ull, 0x4010000204001021ull, 0x2008004248110002ull,
+            0x0491020820080204ull, 0x0841000201008200ull, 0x80004080a4100806ull, 0x8002488202020115ull,
+            0x24020800c1100400ull, 0x21042404b0010801ull, 0x804424001a280200ull, 0x0210040000401020ull,
+            0x6001001005004004ull, 0x0304102014100410ull, 0x00020a0204108280ull, 0x2380802902020200ull,
+            0x4001514000081806ull, 0x4480841024200202ull, 0x1004002080040100ull, 0x0290110800040041ull,
+            0x20400080881a0020ull, 0x0402008201010040ull, 0x0a10820200005504ull, 0x0280a1020c004200ull,
+            0x040404a208144000ull, 0x2002421820011418ull, 0x11000845c8001000ull, 0x0042082011046810ull,
+            0x0080600540402400ull, 0x0102204040809100ull, 0x004448c801000040ull, 0x2048008082000084ull,
+            0xc2244c04200a0040ull, 0x2050804462200000ull, 0x1000204218040010ull, 0x0000007820880090ull,
+            0x4400114405040000ull, 0x080104a024044020ull, 0x4889430808010010ull, 0x0c54010815110040ull,
+            0x4001008201014140ull, 0x0200022101103048ull, 0x0600000046009040ull, 0x0000004430420208ull,
+            0x0a40040008902408ull, 0x3401500810410201ull, 0x0088212054090060ull, 0x10208200a6040140ull
         }
+        : std::array<BB, 64>{
+            0x8080001080204000ull, 0x3840082000401000ull, 0x1300084100102000ull, 0x0480080090008084ull,
+            0x0200020008100420ull, 0x2880020001800400ull, 0x0400180b50040082ull, 0x0200098824020641ull,
+            0x0000800173c00880ull, 0x0001802000804000ull, 0x0081801001200080ull, 0x2100808010000800ull,
+            0x0480800400800800ull, 0x1004800400801600ull, 0x1084000112300814ull, 0x0006000308844422ull,
+            0x8380004000200042ull, 0x0110004040002004ull, 0x0410002000240800ull, 0x4110010011002408ull,
+            0x2804008004080080ull, 0x0008808002000400ull, 0x0001140010210208ull, 0x2a46020034008041ull,
+            0x2108400880008021ull, 0x4440004240201000ull, 0x4002008200201044ull, 0x5080100080080082ull,
+            0x0014040080800800ull, 0x0115002900064400ull, 0x2480088400121110ull, 0x0900428a00030054ull,
+            0x0060004000808000ull, 0x41a0100040400020ull, 0x0220009001802080ull, 0x0000100080800800ull,
+            0x8080040080800800ull, 0x1068040080800200ull, 0x4912000802000401ull, 0x0180090882002044ull,
+            0x0880002000404006ull, 0x02b00a2004414000ull, 0x0000801200220040ull, 0x0001011001090020ull,
+            0x8004008008008004ull, 0x41af000400090002ull, 0x0000108108040002ull, 0x2000004d10820004ull,
+            0x0001008004402500ull, 0x0002400080200280ull, 0x8200841000200480ull, 0x0001001001200900ull,
+            0xa0c2040800110100ull, 0x0045800400020080ull, 0x1000503201480400ull, 0x0002104104008200ull,
+            0x8081805620420102ull, 0x0060400021008013ull, 0x0200102001040841ull, 0x20010010001cc921ull,
+            0x0222000488201082ull, 0x1081000208540007ull, 0x0028180081102a04ull, 0x1040040241142082ull
+        };
+
+    /**
+     * Attack table of a single square. Occupancies of the relevant mask are enumerated with the Carry-Rippler trick,
+     * whose k-th subset is exactly the one PEXT maps to index k. Magic indices are computed explicitly, a collision
+     * between different attack sets stops compilation.
+     */
+    template<bool diag, SliderImpl impl, int sq>
+    constexpr std::array<BB, 1ull << bitCount(arrMask<diag>[sq])> load_slider_table() {
+        constexpr BB fullMask = arrMask<diag>[sq];
+        std::array<BB, 1ull << bitCount(fullMask)> table{};
+        BB occ = 0;
+        size_t k = 0;
+        do {
+            BB attacks = slideMaskSlow<diag>(occ, sq);
+            size_t ix = impl == SliderImpl::Pext ? k : (occ * MAGICS<diag>[sq]) >> arrShift<diag>[sq];
+            if(table[ix] != 0 && table[ix] != attacks) throw "magic index collision";
+            table[ix] = attacks;
+            occ = (occ - fullMask) & fullMask;
+            k++;
+        } while(occ);
+        return table;
     }
 
-    void load_dist() {
-        for(int from = 0; from < 64; from++) {
-            for(int to = 0; to < 64; to++) {
-                DIST[from][to] = manhattan(from, to);
-            }
-        }
+    template<bool diag, SliderImpl impl, int sq>
+    constexpr auto sliderTable = load_slider_table<diag, impl, sq>();
+
+    template<bool diag, SliderImpl impl, size_t... squares>
+    constexpr std::array<const BB*, 64> load_slider_tables(std::index_sequence<squares...>) {
+        return {sliderTable<diag, impl, squares>.data()...};
     }
 
-    void load() {
-        if(!loaded) {
-            for(int i = 0; i < 64; i++) {
-                calculate_lines<true>(i);
-                calculate_lines<false>(i);
-                addKnightMoves(i);
-                addKingMoves(i);
-                load_passed_pawn_mask<true>(i);
-                load_passed_pawn_mask<false>(i);
-            }
-            init_pext();
-            load_dist();
-            loaded = true;
-        }
+    template<bool diag, SliderImpl impl>
+    constexpr std::array<const BB*, 64> sliderAttackBB = load_slider_tables<diag, impl>(std::make_index_sequence<64>{});
+
+#if defined(DORY_SLIDER_DISPATCH) && !defined(__BMI2__)
+    // The intrinsic cannot be inlined into code not compiled for BMI2, never reached unless pextAvailable()
+    inline BB pext(BB occ, BB mask) {
+        BB result;
+        asm("pextq %2, %1, %0" : "=r"(result) : "r"(occ), "rm"(mask));
+        return result;
+    }
+#endif
+
+    template<bool diag, SliderImpl impl>
+    inline int sliderIndex(BB occ, int sq) {
+#ifdef __BMI2__
+        if constexpr (impl == SliderImpl::Pext)
+            return static_cast<int>(_pext_u64(occ, arrMask<diag>[sq]));
+#elif defined(DORY_SLIDER_DISPATCH)
+        if constexpr (impl == SliderImpl::Pext)
+            return static_cast<int>(pext(occ, arrMask<diag>[sq]));
+#endif
+        return static_cast<int>(((occ & arrMask<diag>[sq]) * MAGICS<diag>[sq]) >> arrShift<diag>[sq]);
+    }
+
+    template<bool diag, SliderImpl impl>
+    inline BB slideMask(BB occ, int sq) {
+        return sliderAttackBB<diag, impl>[sq][sliderIndex<diag, impl>(occ, sq)];
+    }
+
+    template<bool diag>
+    inline BB slideMask(BB occ, int sq) {
+#ifdef DORY_SLIDER_DISPATCH
+        if (sliderImpl == SliderImpl::Pext) return slideMask<diag, SliderImpl::Pext>(occ, sq);
+        return slideMask<diag, SliderImpl::Magic>(occ, sq);
+#else
+        return slideMask<diag, NATIVE_SLIDER_IMPL>(occ, sq);
+#endif
+    }
+
+    /**
+     * Calls f.template operator()<impl>() with the implementation slideMask() uses,
+     * so callers with many lookups branch once instead of per lookup.
+     */
+    template<typename F>
+    inline decltype(auto) withSliderImpl(F&& f) {
+#ifdef DORY_SLIDER_DISPATCH
+        if (sliderImpl == SliderImpl::Pext) return f.template operator()<SliderImpl::Pext>();
+        return f.template operator()<SliderImpl::Magic>();
+#else
+        return f.template operator()<NATIVE_SLIDER_IMPL>();
+#endif
+    }
+
+    std::string_view sliderImplName(SliderImpl impl) {
+        return impl == SliderImpl::Pext ? "pext" : "magic";
+    }
+
+    /**
+     * In portable builds slideMask() switches over to the given implementation,
+     * native builds always look up attacks with NATIVE_SLIDER_IMPL.
+     */
+    void useSliderImpl([[maybe_unused]] SliderImpl impl) {
+#ifdef DORY_SLIDER_DISPATCH
+        if (impl == SliderImpl::Pext && !pextAvailable()) impl = SliderImpl::Magic;
+        sliderImpl = impl;
+#endif
     }
 
 } // namespace Dory::PieceSteps
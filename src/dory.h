@@ -5,18 +5,42 @@
 #ifndef DORY_DORY_H
 #define DORY_DORY_H
 
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <span>
+#include <thread>
+
 #include "engine/search.h"
+#include "engine/monte_carlo.h"
+#include "engine/mc.h"
+#include "engine/bitbases.h"
+#include "utils/bench.h"
 #include "utils/perft.h"
 #include "utils/fenreader.h"
+#include "utils/pgn.h"
+#include "utils/polyglot.h"
+#include "utils/san.h"
 
 namespace Dory {
 
+    using Position = std::pair<Board, bool>;
+
+    using SearchLimits = Search::SearchLimits;
+
+    /// Called with the input index and the result whenever a position of a batch is done
+    using AnalysisCallback = std::function<void(size_t, const Result&)>;
+
     class Engine {
         Search::Searcher searcher{};
+        std::vector<std::unique_ptr<Search::Searcher>> workers;
+        Search::TablebaseOptions tbOptions{};
+        size_t hashMb{0};
+        std::vector<uint64_t> batchNodes;
 
     public:
         Engine() {
-            PieceSteps::load();
             Zobrist::init(23984729);
         }
 
@@ -30,10 +54,127 @@ namespace Dory {
             return searchDepth<false>(board, depth);
         }
 
+        /**
+         * Searches all positions on 'numThreads' threads (0 uses all cores), each thread with its own Searcher.
+         * Positions are handed out one at a time, so long and short searches balance across the threads.
+         * The callback runs on the worker threads, but never concurrently.
+         *
+         * @return the results in the order of the input positions
+         */
+        std::vector<Result> analyzeBatch(std::span<const Position> positions, SearchLimits limits = {},
+                                         size_t numThreads = 0, const AnalysisCallback& onDone = {}) {
+            if (numThreads == 0) numThreads = std::thread::hardware_concurrency();
+            numThreads = std::clamp<size_t>(numThreads, 1, std::max<size_t>(positions.size(), 1));
+
+            while (workers.size() < numThreads) {
+                workers.push_back(std::make_unique<Search::Searcher>());
+                workers.back()->tbOptions = tbOptions;
+                if (hashMb) workers.back()->reserveTable(hashMb);
+            }
+
+            std::vector<Result> results(positions.size());
+            batchNodes.assign(positions.size(), 0);
+            std::atomic<size_t> next{0};
+            std::mutex callbackMutex;
+
+            auto work = [&](Search::Searcher& worker) {
+                for (size_t ix = next++; ix < positions.size(); ix = next++) {
+                    Board board = positions[ix].first;
+                    if (positions[ix].second) results[ix] = worker.iterativeDeepening<true>(board, limits);
+                    else results[ix] = worker.iterativeDeepening<false>(board, limits);
+                    batchNodes[ix] = worker.nodesSearched;
+
+                    if (onDone) {
+                        std::lock_guard<std::mutex> lock{callbackMutex};
+                        onDone(ix, results[ix]);
+                    }
+                }
+            };
+
+            std::vector<std::thread> threads;
+            for (size_t t = 1; t < numThreads; t++) {
+                threads.emplace_back(work, std::ref(*workers[t]));
+            }
+            work(*workers[0]);
+            for (auto& thread: threads) thread.join();
+
+            return results;
+        }
+
+        std::vector<Result> analyzeBatch(std::span<const std::string> fens, SearchLimits limits = {},
+                                         size_t numThreads = 0, const AnalysisCallback& onDone = {}) {
+            std::vector<Position> positions;
+            positions.reserve(fens.size());
+            for (const std::string& fen: fens) positions.push_back(Utils::parseFEN(fen));
+            return analyzeBatch(std::span<const Position>{positions}, limits, numThreads, onDone);
+        }
+
+        /**
+         * Hashes (Zobrist::hash) of the positions played before the position of the next searches, oldest first.
+         * Used to detect repetitions of the game, only applies to searchDepth.
+         */
+        void setGameHistory(std::span<const uint64_t> hashes) {
+            searcher.setGameHistory(hashes);
+        }
+
+        /**
+         * Sends the progress of searchDepth to 'reporter', which must outlive the engine or be replaced first.
+         * Nothing is reported by default, batch analysis never reports.
+         */
+        void setReporter(Search::InfoReporter& reporter) {
+            searcher.reporter = &reporter;
+        }
+
+        /**
+         * Searches every bench position to 'depth' with a cleared transposition table. The node count does not depend
+         * on the number of threads, as every position is searched by a single thread from scratch.
+         */
+        Utils::BenchResult bench(int depth, size_t numThreads) {
+            std::vector<Position> positions;
+            for (std::string_view fen: Utils::BENCH_POSITIONS) positions.push_back(Utils::parseFEN(fen));
+
+            Timer timer{};
+            timer.start();
+            analyzeBatch(std::span<const Position>{positions}, SearchLimits{depth}, numThreads);
+            const double seconds = timer.timeSeconds();
+
+            return {std::accumulate(batchNodes.begin(), batchNodes.end(), uint64_t{0}), seconds};
+        }
+
+        /// Records a sampled search tree of the following searches into 'trace', nullptr stops tracing
+        void setTrace(Search::SearchTrace* trace) {
+            searcher.trace = trace;
+        }
+
+        /// Reserves about 'mb' megabytes for the transposition table of every searcher
+        void setHashSize(size_t mb) {
+            hashMb = mb;
+            searcher.reserveTable(mb);
+            for (auto& worker: workers) worker->reserveTable(mb);
+        }
+
+        void setTablebaseOptions(Search::TablebaseOptions options) {
+            tbOptions = options;
+            searcher.tbOptions = options;
+            for (auto& worker: workers) worker->tbOptions = options;
+        }
+
         [[nodiscard]] uint64_t nodesSearched() const { return searcher.nodesSearched; }
 
+        /// Nodes of every position of the last analyzeBatch call, in input order
+        [[nodiscard]] std::span<const uint64_t> batchNodesSearched() const { return batchNodes; }
+
+        [[nodiscard]] uint64_t tbProbes() const { return searcher.tbProbes; }
+
+        [[nodiscard]] uint64_t tbHits() const { return searcher.tbHits; }
+
         [[nodiscard]] uint64_t tableLookups() const { return searcher.tableLookups; }
 
+        /// Per-iteration statistics of the last searchDepth call, see DORY_SEARCH_STATS
+        [[nodiscard]] const Search::SearchStats& searchStats() const { return searcher.stats; }
+
+        [[nodiscard]] std::string searchStatsJSON() const { return searcher.stats.toJSON(); }
+
         [[nodiscard]] size_t trTableSizeKb() const { return searcher.trTableSizeKb(); }
 
         [[nodiscard]] size_t trTableSizeMb() const { return searcher.trTableSizeMb(); }
@@ -43,7 +184,6 @@ namespace Dory {
 namespace DoryUtils {
 
     void initialize() {
-        Dory::PieceSteps::load();
         Dory::Zobrist::init(23984729);
     }
 
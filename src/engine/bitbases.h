@@ -0,0 +1,454 @@
+#ifndef DORY_BITBASES_H
+#define DORY_BITBASES_H
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../core/movecollectors.h"
+#include "tablebases.h"
+
+namespace Dory::Bitbases {
+
+    using Tablebases::WDL;
+    using Tablebases::MaterialKey;
+
+    /// Stored results, from the view of the side to move
+    enum Value : uint8_t {
+        Unknown = 0, Win = 1, Loss = 2, Draw = 3
+    };
+
+    constexpr WDL toWDL(uint8_t value) {
+        constexpr WDL wdl[4] = {Tablebases::WDL_Unknown, Tablebases::WDL_Win, Tablebases::WDL_Loss, Tablebases::WDL_Draw};
+        return wdl[value];
+    }
+
+    constexpr Value fromWDL(WDL wdl) {
+        switch (wdl) {
+            case Tablebases::WDL_Win: return Win;
+            case Tablebases::WDL_Loss: return Loss;
+            case Tablebases::WDL_Draw: return Draw;
+            default: return Unknown;
+        }
+    }
+
+    /// Same position with colors swapped and the board mirrored vertically. Castling rights are dropped.
+    Board flipped(const Board& board) {
+        auto m = [](BB bb) { return static_cast<BB>(__builtin_bswap64(bb)); };
+        return Board{m(board.bPawns), m(board.wPawns), m(board.bKnights), m(board.wKnights), m(board.bBishops),
+                     m(board.wBishops), m(board.bRooks), m(board.wRooks), m(board.bQueens), m(board.wQueens),
+                     static_cast<uint8_t>(board.bKingSq ^ 56), static_cast<uint8_t>(board.wKingSq ^ 56),
+                     static_cast<uint8_t>(board.hasEnPassant() ? board.enPassantSq ^ 56 : 0), 0};
+    }
+
+    BB pieces(const Board& board, bool white, Piece_t piece) {
+        switch (piece) {
+            case PIECE_Queen: return white ? board.wQueens : board.bQueens;
+            case PIECE_Rook: return white ? board.wRooks : board.bRooks;
+            case PIECE_Bishop: return white ? board.wBishops : board.bBishops;
+            case PIECE_Knight: return white ? board.wKnights : board.bKnights;
+            case PIECE_Pawn: return white ? board.wPawns : board.bPawns;
+            default: return 0;
+        }
+    }
+
+    /**
+     * Win / draw / loss of every placement of one material signature, two bits per position. The index holds the side
+     * to move, both kings and then the other pieces, white ones first. Pieces of the same type are stored in
+     * ascending square order.
+     */
+    class Table {
+        struct Slot {
+            bool white;
+            Piece_t piece;
+        };
+
+        std::vector<Slot> slots;
+        std::vector<uint8_t> packed;
+
+    public:
+        MaterialKey key;
+        std::string name;
+        size_t numEntries;
+
+        explicit Table(MaterialKey materialKey) : key{materialKey} {
+            static constexpr char letters[] = "QRBNP";
+            for (bool white: {true, false}) {
+                name += 'K';
+                for (int piece = PIECE_Queen; piece <= PIECE_Pawn; piece++) {
+                    for (uint64_t n = (key >> (4 * piece + (white ? 0 : 20))) & 0xF; n > 0; n--) {
+                        slots.push_back({white, static_cast<Piece_t>(piece)});
+                        name += letters[piece];
+                    }
+                }
+                if (white) name += 'v';
+            }
+            numEntries = size_t{2} << (6 * (2 + slots.size()));
+            packed.assign((numEntries + 3) / 4, 0);
+        }
+
+        [[nodiscard]] size_t index(const Board& board, bool whiteToMove) const {
+            size_t ix = 0;
+            BB remaining{0};
+            Slot current{true, PIECE_None};
+            for (size_t s = slots.size(); s-- > 0;) {
+                if (slots[s].white != current.white || slots[s].piece != current.piece) {
+                    current = slots[s];
+                    remaining = pieces(board, current.white, current.piece);
+                }
+                // the last slot of a piece type takes its highest square
+                const int sq = lastBitOf(remaining);
+                remaining &= ~newMask(sq);
+                ix = (ix << 6) | sq;
+            }
+            ix = (((ix << 6) | board.bKingSq) << 6) | board.wKingSq;
+            return (ix << 1) | !whiteToMove;
+        }
+
+        /// Sets up the position of an index without checking it
+        void place(size_t ix, Board& board, bool& whiteToMove) const {
+            whiteToMove = !(ix & 1);
+            ix >>= 1;
+            const auto wK = static_cast<uint8_t>(ix & 63), bK = static_cast<uint8_t>((ix >> 6) & 63);
+            ix >>= 12;
+
+            BB bbs[2][5]{};
+            for (size_t s = 0; s < slots.size(); s++, ix >>= 6) {
+                bbs[slots[s].white][slots[s].piece] |= newMask(static_cast<int>(ix & 63));
+            }
+            board = Board{bbs[1][PIECE_Pawn], bbs[0][PIECE_Pawn], bbs[1][PIECE_Knight], bbs[0][PIECE_Knight],
+                          bbs[1][PIECE_Bishop], bbs[0][PIECE_Bishop], bbs[1][PIECE_Rook], bbs[0][PIECE_Rook],
+                          bbs[1][PIECE_Queen], bbs[0][PIECE_Queen], wK, bK, 0, 0};
+        }
+
+        /**
+         * Sets up the position of an index.
+         *
+         * @return false if the index does not describe a legal, canonically ordered position
+         */
+        bool setup(size_t ix, Board& board, bool& whiteToMove) const {
+            const size_t squares = ix >> 1;
+            const int wK = static_cast<int>(squares & 63), bK = static_cast<int>((squares >> 6) & 63);
+            if (std::abs(fileOf(wK) - fileOf(bK)) <= 1 && std::abs(rankOf(wK) - rankOf(bK)) <= 1) return false;
+
+            BB occ = newMask(wK) | newMask(bK);
+            int previous = -1;
+            size_t rest = squares >> 12;
+            for (size_t s = 0; s < slots.size(); s++, rest >>= 6) {
+                const int sq = static_cast<int>(rest & 63);
+                if (occ & newMask(sq)) return false;
+                if (slots[s].piece == PIECE_Pawn && (rankOf(sq) == 0 || rankOf(sq) == 7)) return false;
+                if (s > 0 && slots[s].white == slots[s - 1].white && slots[s].piece == slots[s - 1].piece && sq < previous) {
+                    return false;
+                }
+                occ |= newMask(sq);
+                previous = sq;
+            }
+            place(ix, board, whiteToMove);
+
+            // the side that just moved must not be in check
+            PinData pd;
+            if (whiteToMove) CheckLogicHandler::reload<false>(board, pd);
+            else CheckLogicHandler::reload<true>(board, pd);
+            return !pd.inCheck();
+        }
+
+        [[nodiscard]] Value get(size_t ix) const {
+            return static_cast<Value>((packed[ix >> 2] >> (2 * (ix & 3))) & 3);
+        }
+
+        void set(size_t ix, Value value) {
+            packed[ix >> 2] = static_cast<uint8_t>((packed[ix >> 2] & ~(3 << (2 * (ix & 3)))) | (value << (2 * (ix & 3))));
+        }
+
+        bool save(const std::string& path) const {
+            std::ofstream out(path, std::ios::binary);
+            out << name << '\n';
+            out.write(reinterpret_cast<const char*>(packed.data()), static_cast<std::streamsize>(packed.size()));
+            return static_cast<bool>(out);
+        }
+
+        /// Reads a table written by save(), nullptr if the file is not a valid table
+        static std::unique_ptr<Table> load(const std::string& path) {
+            std::ifstream in(path, std::ios::binary);
+            std::string signature;
+            if (!std::getline(in, signature)) return nullptr;
+            MaterialKey materialKey = Tablebases::materialKey(signature);
+            if (!materialKey && signature != "KvK") return nullptr;
+
+            auto table = std::make_unique<Table>(materialKey);
+            in.read(reinterpret_cast<char*>(table->packed.data()), static_cast<std::streamsize>(table->packed.size()));
+            if (in.gcount() != static_cast<std::streamsize>(table->packed.size())) return nullptr;
+            return table;
+        }
+    };
+
+    /**
+     * Compact bitbase of king and pawn against king: one bit per position with the pawn on files a to d, set if the
+     * side with the pawn wins. The other files are mirrored, so the table holds 24 * 64 * 64 * 2 bits.
+     */
+    class KPK {
+        std::vector<uint64_t> bits = std::vector<uint64_t>(24 * 64 * 64 * 2 / 64);
+
+        static size_t index(int pawn, int wK, int bK, bool whiteToMove) {
+            if (fileOf(pawn) > 3) {
+                pawn ^= 7;
+                wK ^= 7;
+                bK ^= 7;
+            }
+            const size_t pawnIx = 4 * (rankOf(pawn) - 1) + fileOf(pawn);
+            return (((pawnIx * 64 + wK) * 64 + bK) << 1) | !whiteToMove;
+        }
+
+    public:
+        /// Compresses a generated KPvK table
+        explicit KPK(const Table& table) {
+            Board board;
+            bool whiteToMove;
+            for (size_t ix = 0; ix < table.numEntries; ix++) {
+                if (!table.setup(ix, board, whiteToMove) || fileOf(firstBitOf(board.wPawns)) > 3) continue;
+                const bool whiteWins = table.get(ix) == (whiteToMove ? Win : Loss);
+                const size_t i = index(firstBitOf(board.wPawns), board.wKingSq, board.bKingSq, whiteToMove);
+                if (whiteWins) bits[i >> 6] |= newMask(static_cast<int>(i & 63));
+            }
+        }
+
+        [[nodiscard]] size_t sizeBytes() const { return bits.size() * sizeof(uint64_t); }
+
+        /// Board with white holding the pawn
+        [[nodiscard]] WDL probe(const Board& board, bool whiteToMove) const {
+            const size_t i = index(firstBitOf(board.wPawns), board.wKingSq, board.bKingSq, whiteToMove);
+            if (!hasBitAt(bits[i >> 6], static_cast<int>(i & 63))) return Tablebases::WDL_Draw;
+            return whiteToMove ? Tablebases::WDL_Win : Tablebases::WDL_Loss;
+        }
+    };
+
+    namespace detail {
+        struct Store {
+            std::unordered_map<MaterialKey, std::unique_ptr<Table>> tables;
+            std::unique_ptr<KPK> kpk;
+        };
+
+        Store& store() {
+            static Store instance;
+            return instance;
+        }
+
+        template<bool whiteToMove>
+        WDL probeNoEnPassant(const Board& board) {
+            auto& tables = store().tables;
+            auto it = tables.find(Tablebases::materialKey(board));
+            if (it != tables.end()) return toWDL(it->second->get(it->second->index(board, whiteToMove)));
+            return Tablebases::WDL_Unknown;
+        }
+
+        /**
+         * Tables do not store en passant rights, positions with an en passant square are resolved by looking one
+         * ply ahead.
+         */
+        template<bool whiteToMove>
+        WDL probe(const Board& board) {
+            if (!board.hasEnPassant()) return probeNoEnPassant<whiteToMove>(board);
+
+            MoveCollectors::MoveList list;
+            Board B{board};
+            list.generate<whiteToMove>(B);
+            if (list.count == 0) return list.pd.inCheck() ? Tablebases::WDL_Loss : Tablebases::WDL_Draw;
+
+            int best = Tablebases::WDL_Loss;
+            for (const Move& move: list) {
+                Board next = B.fork<whiteToMove>(move);
+                const WDL wdl = Tablebases::probeWDL(next, !whiteToMove);
+                if (wdl == Tablebases::WDL_Unknown) return wdl;
+                best = std::max(best, -static_cast<int>(wdl));
+            }
+            return static_cast<WDL>(best);
+        }
+
+        WDL probeTables(const Board& board, bool whiteToMove) {
+            if (store().tables.contains(Tablebases::materialKey(board))) {
+                return whiteToMove ? probe<true>(board) : probe<false>(board);
+            }
+            Board mirror = flipped(board);
+            return whiteToMove ? probe<false>(mirror) : probe<true>(mirror);
+        }
+
+        WDL probeKPK(const Board& board, bool whiteToMove) {
+            if (board.wPawns) return store().kpk->probe(board, whiteToMove);
+            return store().kpk->probe(flipped(board), !whiteToMove);
+        }
+    }
+
+    /**
+     * Fills a table by retrograde analysis in repeated passes over all positions. A position is won if a move
+     * reaches a lost position and lost if every move reaches a won one. Captures and promotions lead into smaller
+     * tables, which must already be registered. Positions left open once a pass changes nothing are draws.
+     */
+    class Generator {
+        Table& table;
+        std::vector<std::atomic<uint8_t>> values;
+
+        template<bool childWhite>
+        Value childValue(Board& child) {
+            if (Tablebases::materialKey(child) != table.key) {
+                return fromWDL(Tablebases::probeWDL(child, childWhite));
+            }
+            if (child.hasEnPassant()) {
+                // en passant rights are not part of the index, look one ply further
+                MoveCollectors::MoveList list;
+                return resolve<childWhite>(child, list);
+            }
+            return static_cast<Value>(values[table.index(child, childWhite)].load(std::memory_order_relaxed));
+        }
+
+        template<bool whiteToMove>
+        Value resolve(Board& board, MoveCollectors::MoveList& list) {
+            list.generate<whiteToMove>(board);
+            if (list.count == 0) return list.pd.inCheck() ? Loss : Draw;
+
+            bool allWon = true;
+            for (const Move& move: list) {
+                Board child = board.fork<whiteToMove>(move);
+                const Value value = childValue<!whiteToMove>(child);
+                if (value == Loss) return Win;
+                allWon &= value == Win;
+            }
+            return allWon ? Loss : Unknown;
+        }
+
+        /// Resolves what it can of [begin, end), returns the number of newly resolved positions
+        size_t pass(size_t begin, size_t end, MoveCollectors::MoveList& list) {
+            size_t resolved = 0;
+            Board board;
+            bool whiteToMove;
+            for (size_t ix = begin; ix < end; ix++) {
+                if (values[ix].load(std::memory_order_relaxed) != Unknown) continue;
+                table.place(ix, board, whiteToMove);
+                const Value value = whiteToMove ? resolve<true>(board, list) : resolve<false>(board, list);
+                if (value != Unknown) {
+                    values[ix].store(value, std::memory_order_relaxed);
+                    resolved++;
+                }
+            }
+            return resolved;
+        }
+
+    public:
+        explicit Generator(Table& t) : table{t}, values(t.numEntries) {}
+
+        /// @return the number of passes
+        int run(size_t numThreads) {
+            numThreads = std::max<size_t>(numThreads, 1);
+            const size_t chunk = 1 << 14;
+
+            Board board;
+            bool whiteToMove;
+            for (size_t ix = 0; ix < table.numEntries; ix++) {
+                values[ix].store(table.setup(ix, board, whiteToMove) ? Unknown : Draw, std::memory_order_relaxed);
+            }
+
+            int passes = 0;
+            for (size_t resolved = 1; resolved > 0; passes++) {
+                std::atomic<size_t> next{0}, total{0};
+                auto work = [&]() {
+                    MoveCollectors::MoveList list;
+                    for (size_t begin = next.fetch_add(chunk); begin < table.numEntries; begin = next.fetch_add(chunk)) {
+                        total += pass(begin, std::min(begin + chunk, table.numEntries), list);
+                    }
+                };
+                std::vector<std::thread> threads;
+                for (size_t t = 1; t < numThreads; t++) threads.emplace_back(work);
+                work();
+                for (auto& thread: threads) thread.join();
+                resolved = total;
+            }
+
+            for (size_t ix = 0; ix < table.numEntries; ix++) {
+                const auto value = static_cast<Value>(values[ix].load(std::memory_order_relaxed));
+                table.set(ix, value == Unknown ? Draw : value);
+            }
+            return passes;
+        }
+    };
+
+    /**
+     * Makes a table answer probes for its material and the color-swapped material.
+     */
+    void add(std::unique_ptr<Table> table) {
+        std::string name = table->name;
+        detail::store().tables[table->key] = std::move(table);
+        Tablebases::registerTable(name, detail::probeTables);
+    }
+
+    /**
+     * Material reached by one capture or promotion.
+     */
+    std::vector<MaterialKey> successors(MaterialKey key) {
+        std::vector<MaterialKey> result;
+        for (int shift = 0; shift < 40; shift += 4) {
+            const MaterialKey one = MaterialKey{1} << shift;
+            if (!((key >> shift) & 0xF)) continue;
+            result.push_back(key - one);                                   // captured
+            if (shift % 20 == 4 * PIECE_Pawn) {                             // promoted
+                for (int piece = PIECE_Queen; piece < PIECE_Pawn; piece++) {
+                    result.push_back(key - one + (MaterialKey{1} << (shift - 4 * PIECE_Pawn + 4 * piece)));
+                }
+            }
+        }
+        return result;
+    }
+
+    /**
+     * Generates the table of a material key, first generating all smaller tables it depends on that are not known
+     * yet. Generated tables are registered for probing.
+     *
+     * @param onTable called with every generated table, e.g. to save it
+     */
+    template<typename F>
+    void generate(MaterialKey key, size_t numThreads, F&& onTable) {
+        if (Tablebases::hasTable(key)) return;
+        for (MaterialKey next: successors(key)) generate(next, numThreads, onTable);
+
+        auto table = std::make_unique<Table>(key);
+        Generator{*table}.run(numThreads);
+        onTable(static_cast<const Table&>(*table));
+        add(std::move(table));
+    }
+
+    /**
+     * Generates the KPK bitbase along with the KQvK and KRvK tables it depends on. Only the first call does any work.
+     */
+    void initKPK(size_t numThreads = std::thread::hardware_concurrency()) {
+        static std::once_flag once;
+        std::call_once(once, [numThreads]() {
+            const MaterialKey key = Tablebases::materialKey("KPvK");
+            generate(key, numThreads, [](const Table&) {});
+
+            auto& tables = detail::store().tables;
+            detail::store().kpk = std::make_unique<KPK>(*tables.at(key));
+            tables.erase(key);
+            Tablebases::registerTable("KPvK", detail::probeKPK);
+        });
+    }
+
+    /// Loads all tables saved in a directory, returns the number of tables
+    size_t loadDirectory(const std::string& path) {
+        size_t loaded = 0;
+        std::error_code error;
+        for (auto& entry: std::filesystem::directory_iterator(path, error)) {
+            if (entry.path().extension() != ".bb") continue;
+            if (auto table = Table::load(entry.path().string())) {
+                add(std::move(table));
+                loaded++;
+            }
+        }
+        return loaded;
+    }
+
+} // namespace Dory::Bitbases
+
+#endif //DORY_BITBASES_H
@@ -5,57 +5,156 @@
 #ifndef DORY_MC_H
 #define DORY_MC_H
 
+#include <algorithm>
+
 #include "../core/board.h"
 #include "search.h"
+#include "monte_carlo.h"
 
 namespace Dory::MonteCarlo {
-//
-//    template<bool whiteToMove>
-//    int handle(Board &board, int depth) {
-////        auto [eval, line] = Dory::Search::Searcher::iterativeDeepening<whiteToMove>(board, depth);
-////
-////        if (line.empty()) {
-////            // Game over
-////            if (eval > (INF - 50)) {
-////                // White wins by Checkmate
-//////                    std::cout << "Checkmate - White wins!  (" << (ply / 2) << " moves)" << std::endl;
-////                return whiteToMove ? 3 : 1;
-////            } else if (eval < -(INF - 50)) {
-////                // Black wins by Checkmate
-//////                    std::cout << "Checkmate - Black wins!  (" << (ply / 2) << " moves)" << std::endl;
-////                return whiteToMove ? 1 : 3;
-////            }
-////                std::cout << "Draw - Threefold repetition!  (" << (ply / 2) << " moves)" << std::endl;
-//            return 2;
-//        }
-//
-//        Move nextMove = line.back();
-//        if constexpr (whiteToMove) {
-//            std::cout << Utils::moveNameShortNotation(nextMove) << "  ";
-//        } else {
-//            std::cout << Utils::moveNameShortNotation(nextMove) << std::endl;
-//        }
-//
-//        Dory::Search::Searcher::repTable.insert(Zobrist::hash<whiteToMove>(board));
-//
-//        board.makeMove<whiteToMove>(nextMove);
-//
-//        return 0;
-//    }
-//
-//    template<bool whiteToMove>
-//    int simulateGame(const Board &board, int depth, int maxMoves = 100) {
-//        Board B{board};
-//        int res;
-//        for(int i = 0; i < maxMoves; ++i) {
-//            res = handle<whiteToMove>(B, depth);
-//            if(res) return res-1;
-//            res = handle<!whiteToMove>(B, depth);
-//            if(res) return res-1;
-//        }
-//        return 1;
-//    }
 
+    const double USE_ENGINE_BEST_MOVES_PROBABILITY = 0.95;
+    const int MAX_SIMULATION_MOVES = 200;
+
+    struct SimulationStats {
+        uint64_t whiteWins{0}, draws{0}, blackWins{0};
+        uint64_t plies{0};
+
+        [[nodiscard]] uint64_t games() const { return whiteWins + draws + blackWins; }
+
+        /// Expected score for white between 0 and 1
+        [[nodiscard]] double whiteScore() const {
+            return games() ? (whiteWins + 0.5 * draws) / static_cast<double>(games()) : 0.5;
+        }
+
+        SimulationStats& operator+=(const SimulationStats& other) {
+            whiteWins += other.whiteWins;
+            draws += other.draws;
+            blackWins += other.blackWins;
+            plies += other.plies;
+            return *this;
+        }
+    };
+
+    /**
+     * Plays games against itself with shallow searches. Each move is the best move of the search with probability
+     * 'engineProbability' and a uniformly random legal move otherwise, so repeated games from one position diverge.
+     *
+     * Games end on checkmate, stalemate, threefold repetition, the 50 move rule, insufficient material and after
+     * MAX_SIMULATION_MOVES moves (counted as a draw).
+     */
+    class GameSimulator {
+        Search::Searcher searcher{};
+        Utils::WyRand rng;
+        MoveCollectors::MoveList buffer;
+        std::vector<uint64_t> history;
+        int depth;
+        double engineProbability;
+
+        static constexpr int Ongoing = 2;
+
+    public:
+        explicit GameSimulator(int searchDepth, double engineProbability = USE_ENGINE_BEST_MOVES_PROBABILITY,
+                               uint64_t seed = std::random_device{}())
+            : rng{seed}, depth{searchDepth}, engineProbability{engineProbability} {
+            history.reserve(2 * MAX_SIMULATION_MOVES + 1);
+        }
+
+        /**
+         * @return 1 if white wins, -1 if black wins and 0 for a draw
+         */
+        int simulateGame(const Board& board, bool whiteToMove, SimulationStats& stats) {
+            if (whiteToMove) return simulateGame<true>(board, stats);
+            return simulateGame<false>(board, stats);
+        }
+
+        template<bool whiteToMove>
+        int simulateGame(const Board& board, SimulationStats& stats) {
+            Board B{board};
+            history.clear();
+            history.push_back(Zobrist::hash<whiteToMove>(B));
+
+            int res = 0;
+            for (int i = 0; i < MAX_SIMULATION_MOVES; ++i) {
+                res = handle<whiteToMove>(B, stats);
+                if (res != Ongoing) break;
+                res = handle<!whiteToMove>(B, stats);
+                if (res != Ongoing) break;
+            }
+            if (res == Ongoing) res = 0;
+
+            if (res > 0) stats.whiteWins++;
+            else if (res < 0) stats.blackWins++;
+            else stats.draws++;
+            return res;
+        }
+
+    private:
+        /// Only positions since the last capture or pawn move can repeat
+        [[nodiscard]] bool isThreefold(uint64_t hash, int halfmoveClock) const {
+            const auto since = history.end() - std::min<ptrdiff_t>(halfmoveClock + 1, std::ssize(history));
+            return std::count(since, history.end(), hash) >= 3;
+        }
+
+        /**
+         * Plays one move for the side to move, returns the game result from white's view once the game is over.
+         */
+        template<bool whiteToMove>
+        int handle(Board& board, SimulationStats& stats) {
+            constexpr int lost = whiteToMove ? -1 : 1;
+
+            buffer.template generate<whiteToMove>(board);
+            if (buffer.count == 0) {
+                return buffer.pd.inCheck() ? lost : 0;
+            }
+            if (board.halfmoveClock >= 100 || PlayoutKernel::insufficientMaterial(board)) return 0;
+
+            Move move = NULLMOVE;
+            if (rng.chance(engineProbability)) {
+                Result result = searcher.iterativeDeepening<whiteToMove>(board, depth);
+                if (!result.line.empty()) move = result.line.back();
+            }
+            if (move == NULLMOVE) {
+                move = buffer.moves[rng.below(buffer.count)];
+            }
+
+            board.makeMove<whiteToMove>(move);
+            stats.plies++;
+
+            const uint64_t hash = Zobrist::hash<!whiteToMove>(board);
+            history.push_back(hash);
+            if (isThreefold(hash, board.halfmoveClock)) return 0;
+
+            return Ongoing;
+        }
+    };
+
+    /**
+     * Simulates 'games' games from one position on 'numThreads' threads, each with its own Searcher.
+     */
+    SimulationStats runSimulations(const Board& board, bool whiteToMove, size_t games, int depth, size_t numThreads,
+                                   double engineProbability = USE_ENGINE_BEST_MOVES_PROBABILITY) {
+        numThreads = std::max<size_t>(numThreads, 1);
+        std::vector<SimulationStats> results(numThreads);
+        std::vector<std::thread> threads;
+        std::atomic<size_t> started{0};
+        std::random_device dev;
+
+        for (size_t t = 0; t < numThreads; t++) {
+            uint64_t seed = (static_cast<uint64_t>(dev()) << 32) | dev();
+            threads.emplace_back([&, seed, &result = results[t]]() {
+                GameSimulator simulator{depth, engineProbability, seed};
+                while (started.fetch_add(1, std::memory_order_relaxed) < games) {
+                    simulator.simulateGame(board, whiteToMove, result);
+                }
+            });
+        }
+        for (auto& thread: threads) thread.join();
+
+        SimulationStats total;
+        for (auto& result: results) total += result;
+        return total;
+    }
 
 } // namespace Dory::MonteCarlo
 
@@ -5,304 +5,476 @@
 #ifndef DORY_MONTE_CARLO_H
 #define DORY_MONTE_CARLO_H
 
-namespace Dory::MonteCarlo {
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
 
-#include "search.h"
+#include "../core/movecollectors.h"
 #include "../utils/random.h"
 
-    double USE_ENGINE_BEST_MOVES_PROBABILITY = 0.95;
-    double USE_RANDOM_MOVE_IN_ROLLOUT = 0.5;
+namespace Dory::MonteCarlo {
+
+    // Game results in half points from the view of the side to move
+    const uint8_t RESULT_Loss = 0, RESULT_Draw = 1, RESULT_Win = 2;
+
+    const int MAX_PLAYOUT_PLIES = 300;
+
+    struct PlayoutStats {
+        uint64_t wins{0}, draws{0}, losses{0};
+        uint64_t plies{0};
+
+        [[nodiscard]] uint64_t games() const { return wins + draws + losses; }
+
+        PlayoutStats& operator+=(const PlayoutStats& other) {
+            wins += other.wins;
+            draws += other.draws;
+            losses += other.losses;
+            plies += other.plies;
+            return *this;
+        }
+    };
+
+    /**
+     * Plays uniformly random games. Every ply generates into a fixed buffer and the colors alternate at compile time,
+     * so the only runtime dispatch is playing the chosen move.
+     *
+     * A game is over on checkmate, stalemate, after 50 moves without pawn move or capture and when neither side has
+     * mating material left (at most a single minor piece on the board). Games exceeding MAX_PLAYOUT_PLIES count as
+     * a draw.
+     */
+    class PlayoutKernel {
+        static constexpr uint8_t Ongoing = 3;
+
+        Utils::WyRand rng;
+        MoveCollectors::MoveList buffer;
+        uint64_t plies{0};
 
-    class MonteCarlo {
-        static Utils::Random random;
     public:
+        explicit PlayoutKernel(uint64_t seed = std::random_device{}()) : rng{seed} {}
+
+        /**
+         * The 50 move rule counts on from the halfmove clock of 'board'.
+         *
+         * @return the result from the view of the side to move in the given position
+         */
+        uint8_t run(const Board& board, bool whiteToMove) {
+            if (whiteToMove) return run<true>(board);
+            return run<false>(board);
+        }
 
         template<bool whiteToMove>
-        static void runSimulations(const Board &board, int depth, int numSimulations) {
-            int wins{0}, losses{0};
-            for (int i = 1; i <= numSimulations; i++) {
-                EngineMC::reset();
-                int res = simulateGame<whiteToMove>(board, depth);
-                if (res == 1) wins++;
-                else if (res == -1) losses++;
+        uint8_t run(Board board) {
+            if (insufficientMaterial(board)) return RESULT_Draw;
+            for (int ply = 0; ply < MAX_PLAYOUT_PLIES; ply += 2) {
+                uint8_t result = step<whiteToMove>(board);
+                if (result != Ongoing) return result;
+                result = step<!whiteToMove>(board);
+                if (result != Ongoing) return RESULT_Win - result;
+            }
+            return RESULT_Draw;
+        }
 
+        /**
+         * Runs 'count' independent playouts from the same position.
+         */
+        PlayoutStats runBatch(const Board& board, bool whiteToMove, size_t count) {
+            PlayoutStats stats;
+            uint64_t pliesBefore = plies;
+            for (size_t i = 0; i < count; i++) {
+                switch (run(board, whiteToMove)) {
+                    case RESULT_Win: stats.wins++; break;
+                    case RESULT_Draw: stats.draws++; break;
+                    default: stats.losses++;
+                }
             }
-            std::cout << "\n" << wins << " wins, " << losses << " losses, " << numSimulations << " games" << std::endl;
+            stats.plies = plies - pliesBefore;
+            return stats;
         }
 
+        [[nodiscard]] uint64_t pliesPlayed() const { return plies; }
+
+        [[nodiscard]] static bool insufficientMaterial(const Board& board) {
+            return board.insufficientMaterial();
+        }
 
+    private:
+        /**
+         * Plays one random move, returns the result from the view of the side to move if the game is over.
+         */
         template<bool whiteToMove>
-        static int simulateGame(const Board &board, int depth, int ply = 0) {
-
-//            Utils::print_board(currentBoard);
-//            std::cout << (currentState.whiteToMove ? "White" : "Black") << " to move" << std::endl;
-            auto [eval, line] = EngineMC::iterativeDeepening<whiteToMove>(board, depth);
-
-            if (line.empty()) {
-                // Game over
-                if (eval > (INF - 50)) {
-                    // White wins by Checkmate
-//                    std::cout << "Checkmate - White wins!  (" << (ply / 2) << " moves)" << std::endl;
-                    return whiteToMove ? 2 : 0;
-                } else if (eval < -(INF - 50)) {
-                    // Black wins by Checkmate
-//                    std::cout << "Checkmate - Black wins!  (" << (ply / 2) << " moves)" << std::endl;
-                    return whiteToMove ? 0 : 2;
+        uint8_t step(Board& board) {
+            buffer.template generate<whiteToMove>(board);
+            if (buffer.count == 0) {
+                return buffer.pd.inCheck() ? RESULT_Loss : RESULT_Draw;
+            }
+            if (board.halfmoveClock >= 100) return RESULT_Draw;
+
+            const Move move = buffer.moves[rng.below(buffer.count)];
+            const bool capture = board.isCapture<whiteToMove>(move);
+            board.makeMove<whiteToMove>(move);
+            plies++;
+
+            if (capture && insufficientMaterial(board)) return RESULT_Draw;
+            return Ongoing;
+        }
+    };
+
+    /**
+     * Runs 'count' random playouts from one position, split evenly across 'numThreads' threads.
+     */
+    PlayoutStats playoutBatch(const Board& board, bool whiteToMove, size_t count, size_t numThreads) {
+        numThreads = std::max<size_t>(numThreads, 1);
+        std::vector<PlayoutStats> results(numThreads);
+        std::vector<std::thread> threads;
+        std::random_device dev;
+
+        for (size_t t = 0; t < numThreads; t++) {
+            size_t share = count / numThreads + (t < count % numThreads);
+            uint64_t seed = (static_cast<uint64_t>(dev()) << 32) | dev();
+            threads.emplace_back([&board, whiteToMove, share, seed, &result = results[t]]() {
+                PlayoutKernel kernel{seed};
+                result = kernel.runBatch(board, whiteToMove, share);
+            });
+        }
+        for (auto& thread: threads) thread.join();
+
+        PlayoutStats total;
+        for (auto& result: results) total += result;
+        return total;
+    }
+
+    /**
+     * Monte Carlo tree search over an arena of preallocated nodes.
+     *
+     * Nodes are addressed by index, the children of a node occupy a contiguous range of the arena and all node data
+     * is stored as structure of arrays. Once the arena is full the tree stops growing and playouts start from the
+     * leaves reached so far. After a move is played the subtree below it is compacted into a second arena and kept.
+     *
+     * Searching with several threads shares one tree. Node statistics are atomic counters and a node is expanded
+     * by whichever thread claims it first. Threads descending through a node add a virtual loss to it, which makes
+     * it less attractive for the other threads until the playout result is backpropagated.
+     */
+    class GameTree {
+        using Index = uint32_t;
+        static constexpr Index NoChildren = 0;
+
+        // Node state
+        static constexpr uint8_t Leaf = 0, Expanding = 1, Expanded = 2, Checkmate = 3, Stalemate = 4;
+
+        // Visits a thread adds to every node on its path before the playout result is known
+        static constexpr uint32_t VIRTUAL_LOSS = 3;
+
+        struct Arena {
+            std::vector<std::atomic<uint32_t>> visits;
+            std::vector<std::atomic<uint32_t>> score;   // half points from the view of the side that moved into the node
+            std::vector<std::atomic<uint8_t>> state;
+            std::vector<Index> firstChild;              // written before the node is published as Expanded
+            std::vector<uint8_t> numChildren;
+            std::vector<PackedMove> move;
+            std::atomic<Index> size{0};
+
+            explicit Arena(size_t capacity)
+                : visits(capacity), score(capacity), state(capacity), firstChild(capacity), numChildren(capacity),
+                  move(capacity) {}
+
+            [[nodiscard]] size_t capacity() const { return visits.size(); }
+
+            /**
+             * Reserves 'count' consecutive nodes, fails if they do not fit into the arena anymore.
+             */
+            bool allocate(size_t count, Index& first) {
+                Index current = size.load(std::memory_order_relaxed);
+                do {
+                    if (current + count > capacity()) return false;
+                } while (!size.compare_exchange_weak(current, current + count, std::memory_order_relaxed));
+
+                first = current;
+                for (Index ix = first; ix < first + count; ix++) {
+                    visits[ix].store(0, std::memory_order_relaxed);
+                    score[ix].store(0, std::memory_order_relaxed);
+                    state[ix].store(Leaf, std::memory_order_relaxed);
+                    firstChild[ix] = NoChildren;
+                    numChildren[ix] = 0;
                 }
-//                std::cout << "Draw - Threefold repetition!  (" << (ply / 2) << " moves)" << std::endl;
-                return 1;
+                return true;
+            }
+
+            void reset() {
+                Index root;
+                size.store(0, std::memory_order_relaxed);
+                allocate(1, root);
             }
+        };
+
+        /**
+         * Per thread playout state.
+         */
+        struct Worker {
+            PlayoutKernel kernel{};
+            MoveCollectors::MoveList buffer;
+            std::vector<Index> path;
+        };
+
+        Arena arenas[2];
+        Arena* arena{&arenas[0]};
+        Arena* spare{&arenas[1]};
+        Board rootBoard{};
+        bool rootWhite{true};
+        double exploration;
+        Worker mainWorker;
+
+    public:
+        explicit GameTree(size_t maxNodes = 1 << 22, double c = 1.414)
+            : arenas{Arena(maxNodes), Arena(maxNodes)}, exploration(c) {
+            setPosition(STARTBOARD, true);
+        }
 
-//            printf("%zu\n", Searcher::bestMoves().size());
-//            printf("%zu\n", Searcher::topLevelLegalMoves().size());
+        GameTree(const GameTree&) = delete;
+        GameTree& operator=(const GameTree&) = delete;
 
-//            nextMove = line.back();
+        void setPosition(const Board& board, bool whiteToMove) {
+            rootBoard = board;
+            rootWhite = whiteToMove;
+            arena->reset();
+        }
 
-            Move nextMove;
-            if (random.bernoulli(USE_ENGINE_BEST_MOVES_PROBABILITY)) {
-                nextMove = random.randomElementOf(EngineMC::bestMoves);
-            } else {
-//                std::cout << "Picking legal move at random" << std::endl;
-                nextMove = random.randomElementOf(EngineMC::topLevelLegalMoves()).second;
+        void search(size_t playouts) {
+            for (size_t i = 0; i < playouts; i++) {
+                playout(mainWorker);
             }
+        }
 
-//            std::cout << "Eval:  " << eval << std::endl;
-//            Utils::printMove(nextMove);
+        /**
+         * Runs the given number of playouts on 'numThreads' threads sharing this tree.
+         */
+        void search(size_t playouts, size_t numThreads) {
+            if (numThreads <= 1) {
+                search(playouts);
+                return;
+            }
 
-            // Count moves since last pawn move or capture
-//        if(nextMove.piece == Piece::Pawn || board.isCapture<whiteToMove>(nextMove)) {
-//            action_counter = 0;
-//            Searcher::repTable.reset();
-//        } else if(action_counter++ >= 100) {
-////                std::cout << "Draw - 50 move rule!  (" << (ply / 2) << " moves)" << std::endl;
-//            return 1;
-//        }
+            std::atomic<size_t> started{0};
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < numThreads; t++) {
+                threads.emplace_back([this, &started, playouts]() {
+                    Worker worker;
+                    while (started.fetch_add(1, std::memory_order_relaxed) < playouts) {
+                        playout(worker);
+                    }
+                });
+            }
+            for (auto& thread: threads) thread.join();
+        }
 
-            EngineMC::repTable.insert(Zobrist::hash<whiteToMove>(board));
+        /**
+         * Plays the given move on the root position and keeps the subtree below it.
+         * Must not be called while a search is running.
+         *
+         * @return whether a subtree could be reused
+         */
+        bool advance(Move move) {
+            Board next = rootBoard;
+            next.makeMove(move, rootWhite);
+
+            Index child = findChild(0, PackedMove{move});
+            if (child == NoChildren) {
+                setPosition(next, !rootWhite);
+                return false;
+            }
+
+            spare->reset();
+            copySubtree(child, 0);
+            std::swap(arena, spare);
 
-            board.makeMove<whiteToMove>(nextMove);
+            rootBoard = next;
+            rootWhite = !rootWhite;
+            return true;
+        }
 
-            ply++;
-            if (ply == 200) // After 200 moves of simulation a game is considered a draw
-                return 1;
+        /**
+         * The most visited move at the root, NULLMOVE if the root has no legal moves.
+         */
+        [[nodiscard]] Move bestMove() const {
+            Index best = NoChildren;
+            for (Index child: children(0)) {
+                if (best == NoChildren || visits(child) > visits(best)) best = child;
+            }
+            return best == NoChildren ? NULLMOVE : rootBoard.unpack(arena->move[best]);
+        }
 
-            return simulatePly<!whiteToMove>(board, ply, depth);
+        struct MoveStats {
+            Move move;
+            uint32_t visits;
+            double score;
+        };
 
-//            if (ply % 2 == 1) {
-//                fen << (1 + (ply >> 1)) << ". ";
-//            }
-//            fen << Utils::moveNameNotation(nextMove) << " ";
+        [[nodiscard]] std::vector<MoveStats> rootStats() const {
+            std::vector<MoveStats> stats;
+            for (Index child: children(0)) {
+                stats.push_back({rootBoard.unpack(arena->move[child]), visits(child), averageScore(child)});
+            }
+            std::sort(stats.begin(), stats.end(), [](auto& a, auto& b) { return a.visits > b.visits; });
+            return stats;
         }
 
-//    template<bool whiteToMove>
-//    static int simulateGame(const Board& board, int depth) {
-//        Searcher::reset();
-//
-//        int action_counter = 0;
-////        std::stringstream fen{};
-//
-//        simulatePly<whiteToMove>()
-//
-//
-////        std::cout << "Game aborted" << std::endl;
-//        return 1;
-//
-////        fen << "\n";
-////        return fen.str();
-////        throw std::runtime_error("Game simulation aborted unexpectedly");
-//    }
-    };
+        [[nodiscard]] uint32_t rootVisits() const { return visits(0); }
+
+        [[nodiscard]] size_t size() const { return arena->size.load(std::memory_order_relaxed); }
+
+        [[nodiscard]] size_t capacity() const { return arena->capacity(); }
+
+    private:
+        struct ChildRange {
+            Index first, last;
+            struct Iterator {
+                Index ix;
+                Index operator*() const { return ix; }
+                Iterator& operator++() { ix++; return *this; }
+                bool operator!=(const Iterator& other) const { return ix != other.ix; }
+            };
+            [[nodiscard]] Iterator begin() const { return {first}; }
+            [[nodiscard]] Iterator end() const { return {last}; }
+        };
+
+        [[nodiscard]] ChildRange children(Index node) const {
+            Index first = arena->firstChild[node];
+            return {first, first + arena->numChildren[node]};
+        }
 
-    Utils::Random MonteCarlo::random{};
+        [[nodiscard]] uint32_t visits(Index node) const {
+            return arena->visits[node].load(std::memory_order_relaxed);
+        }
 
+        [[nodiscard]] uint8_t state(Index node) const {
+            return arena->state[node].load(std::memory_order_acquire);
+        }
 
-    int randomPlayout(Board &board, State state, Utils::Random rand) {
-        bool white = state.whiteToMove;
+        [[nodiscard]] double averageScore(Index node) const {
+            uint32_t n = visits(node);
+            return n ? arena->score[node].load(std::memory_order_relaxed) / (2.0 * n) : 0;
+        }
 
-        // After 300 moves of simulation a game is considered a draw
-        for (int ply{0}; ply < 600; ply++) {
-            std::vector<Move> moveList;
-            MoveListGenerator::getMoves<false>(board, state, moveList);
+        [[nodiscard]] Index findChild(Index node, PackedMove move) const {
+            for (Index child: children(node)) {
+                if (arena->move[child] == move) return child;
+            }
+            return NoChildren;
+        }
 
-            if (moveList.empty()) {
-                if (MoveGenerator<MoveListGenerator, false>::pd->inCheck()) {
-                    // Checkmate
-                    return state.whiteToMove == white ? 0 : 2;
+        Index selectChild(Index node) const {
+            const double logVisits = std::log(static_cast<double>(visits(node)));
+            Index best = arena->firstChild[node];
+            double bestUct = -1;
+            for (Index child: children(node)) {
+                uint32_t n = visits(child);
+                if (n == 0) return child;
+                double uct = averageScore(child) + exploration * std::sqrt(logVisits / n);
+                if (uct > bestUct) {
+                    bestUct = uct;
+                    best = child;
                 }
-                return 1;
             }
+            return best;
+        }
 
-//        Move move;
-//        if (rand.bernoulli(USE_RANDOM_MOVE_IN_ROLLOUT)) {
-//            move = rand.randomElementOf(moveList);
-//        } else {
-//            int bestEval;
-//            move = moveList.back();
-//            moveList.pop_back();
-//            for(Move m: moveList) {
-//                auto [nextBoard, nextState] = fork(board, state, m);
-//                int eval = subjectiveEval(evaluation::evaluatePosition(nextBoard, nextState), nextState);
-//                if(eval > bestEval) {
-//                    bestEval = eval;
-//                    move = m;
-//                }
-//            }
-//        }
-
-            Move move = rand.randomElementOf(moveList);
-            board.makeMove(state, move);
-            state.update(move.flags);
+        void descend(Worker& worker, Index& node, Board& board, bool& whiteToMove) {
+            node = selectChild(node);
+            arena->visits[node].fetch_add(VIRTUAL_LOSS, std::memory_order_relaxed);
+            board.makeMove(board.unpack(arena->move[node]), whiteToMove);
+            whiteToMove = !whiteToMove;
+            worker.path.push_back(node);
         }
 
-        return 1;
-    }
+        /**
+         * Generates the children of a leaf claimed by this thread. Nodes without legal moves become terminal,
+         * nodes that do not fit into the arena anymore become leaves again.
+         */
+        void expand(Worker& worker, Index node, Board& board, bool whiteToMove) {
+            MoveCollectors::MoveList& buffer = worker.buffer;
+            buffer.generate(board, whiteToMove);
+            if (buffer.count == 0) {
+                arena->state[node].store(buffer.pd.inCheck() ? Checkmate : Stalemate, std::memory_order_release);
+                return;
+            }
 
+            Index first = NoChildren;
+            if (!arena->allocate(buffer.count, first)) {
+                arena->state[node].store(Leaf, std::memory_order_release);
+                return;
+            }
+            for (size_t i = 0; i < buffer.count; i++) {
+                arena->move[first + i] = PackedMove{buffer.moves[i]};
+            }
+            arena->firstChild[node] = first;
+            arena->numChildren[node] = buffer.count;
+            arena->state[node].store(Expanded, std::memory_order_release);
+        }
 
-    struct TreeNode;
-    using TPT = std::shared_ptr<TreeNode>;
+        void playout(Worker& worker) {
+            Board board = rootBoard;
+            bool whiteToMove = rootWhite;
+            Index node = 0;
 
-    struct ChildrenData {
-        Move move;
-        TPT node;
-        float score;
-    };
+            worker.path.clear();
+            worker.path.push_back(node);
+            arena->visits[node].fetch_add(VIRTUAL_LOSS, std::memory_order_relaxed);
 
-    struct TreeNode {
-        int wins{0};
-        int total{0};
-        TPT parent;
-        int index;
-        std::vector<ChildrenData> children;
+            /// 1. SELECT
+            while (state(node) == Expanded) {
+                descend(worker, node, board, whiteToMove);
+            }
 
-        TreeNode(TPT &pt, int ix) : parent(pt), index(ix) {}
+            /// 2. EXPAND
+            // a leaf is expanded on its second visit, the thread that claims it does the work
+            uint8_t leafState = Leaf;
+            if ((node == 0 || visits(node) > VIRTUAL_LOSS) && size() < capacity()
+                && arena->state[node].compare_exchange_strong(leafState, Expanding, std::memory_order_acquire)) {
+                expand(worker, node, board, whiteToMove);
+                if (state(node) == Expanded) {
+                    descend(worker, node, board, whiteToMove);
+                }
+            }
 
-        ~TreeNode() {
-            for (auto &[_, x, _2]: children) {
-                x.reset();
+            /// 3. SIMULATE
+            uint8_t result;
+            uint8_t nodeState = state(node);
+            if (nodeState == Checkmate) result = RESULT_Loss;
+            else if (nodeState == Stalemate) result = RESULT_Draw;
+            else result = worker.kernel.run(board, whiteToMove);
+
+            /// 4. BACKPROPAGATE
+            // the result is seen from the side to move at the leaf, the node itself stores it for the other side
+            uint8_t score = RESULT_Win - result;
+            for (auto it = worker.path.rbegin(); it != worker.path.rend(); ++it) {
+                arena->visits[*it].fetch_sub(VIRTUAL_LOSS - 1, std::memory_order_relaxed);
+                arena->score[*it].fetch_add(score, std::memory_order_relaxed);
+                score = RESULT_Win - score;
             }
         }
-    };
 
-//    class GameTree {
-//        Board startBoard;
-//        State startState;
-//        Utils::Random random;
-//
-//        const double c = 1.414;
-//
-//    public:
-//        TPT root;
-//
-//        GameTree(const Board &board, const State &state) : startBoard{board}, startState(state) {
-//            root = std::make_unique<TreeNode>(root, 0);
-//        }
-//
-//        ~GameTree() {
-//            root.reset();
-//        }
-//
-//        void run() {
-//            /// 1. SELECT
-//            TPT node = root;
-//            Board board = startBoard;
-//            State state = startState;
-//
-//            while (!node->children.empty()) {
-//                ChildrenData best = node->children.front();
-//                for (auto &cd: node->children) {
-//                    if (cd.node->total > 0) {
-//                        cd.score = static_cast<double>(cd.node->wins) / cd.node->total +
-//                                   c * std::sqrt(std::sqrt(node->total) / cd.node->total);
-//                        if (cd.score <= best.score) {
-//                            continue;
-//                        }
-//                    } else cd.score = INFINITY;
-//                    best = cd;
-//                }
-//
-//                auto [move, next, _] = best;
-//                board.makeMove(state, move);
-//                state.update(move.flags);
-//                node = next;
-//            }
-//
-//            /// 2. EXPAND
-//            if (node->total > 0) {
-//                currentNode = node;
-//                generate<MC, false>(board, state);
-//
-//                if (currentNode->children.empty()) {
-//                    // currentNode is terminal
-//                    return;
-//                }
-//
-//                ChildrenData child = random.randomElementOf(currentNode->children);
-//                board.makeMove(state, child.move);
-//                state.update(child.move.flags);
-//                node = child.node;
-//            }
-//
-//            /// 3. SIMULATE
-//            int result = randomPlayout(board, state, random);
-//            //        int result = MonteCarlo::simulateGame(board, state, depth);
-//
-//
-//            /// 4. BACKPROPAGATE
-//            node->wins += result;
-//            node->total += 2;
-//
-//            while (node != root) {
-//                node = node->parent;
-//                node->wins += result;
-//                node->total += 2;
-//            }
-//
-////            int ix = node->index;
-////            float score = static_cast<double>(node->result) / node->total + c * std::sqrt(std::sqrt(node->parent->total + 2) / node->total);
-////            node->children.at(ix).score = score;
-////            for(unsigned int index = ix+1; index < node->children.size(); index++)
-////                updateScore(node->children.at(index).node);
-////            while(ix > 0 && node->children.at(ix-1).score < score) {
-////                // ensure children list sorted desc by score
-////                updateScore(node->children.at(ix-1).node);
-////                std::swap(node->children.at(ix-1), node->children.at(ix));
-////                node->children.at(ix-1).node->index = ix-1;
-////                node->children.at(ix).node->index = ix;
-////                ix--;
-////            }
-////        }
-//
-//        }
-//
-//        static TPT currentNode;
-//
-//        class MC {
-//            template<State state, Piece_t piece, Flag_t flags = MoveFlag::Silent>
-//            static void registerMove([[maybe_unused]] const Board &board, BB from, BB to) {
-//                ChildrenData cd{
-//                        createMoveFromBB(from, to, piece, flags),
-//                        std::make_shared<TreeNode>(currentNode, currentNode->children.size()),
-//                        0
-//                };
-//                currentNode->children.emplace_back(cd);
-//            }
-//
-//            friend class MoveGenerator<MC, false>;
-//        };
-//    };
-//
-//    TPT GameTree::currentNode{nullptr};
-//
-//
-//    Move MCTS(const Board &board, const State state, int iterations = 25000) {
-//        GameTree gt{board, state};
-//        for (int i = 0; i < iterations; i++) {
-//            gt.run();
-//        }
-//        ChildrenData best = *std::max_element(gt.root->children.begin(), gt.root->children.end(),
-//                                              [](auto &a, auto &b) { return a.score < b.score; });
-//        return best.move;
-//    }
+        /**
+         * Copies the subtree rooted at 'node' into the spare arena at index 'target', keeping sibling ranges contiguous.
+         */
+        void copySubtree(Index node, Index target) {
+            spare->visits[target].store(visits(node), std::memory_order_relaxed);
+            spare->score[target].store(arena->score[node].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            spare->state[target].store(state(node), std::memory_order_relaxed);
+            spare->move[target] = arena->move[node];
+            spare->numChildren[target] = arena->numChildren[node];
+            spare->firstChild[target] = NoChildren;
+
+            if (arena->numChildren[node] == 0) return;
+
+            Index first = NoChildren;
+            spare->allocate(arena->numChildren[node], first);
+            spare->firstChild[target] = first;
+            Index i = 0;
+            for (Index child: children(node)) {
+                copySubtree(child, first + i++);
+            }
+        }
+    };
 
 } // namespace Dory::MonteCarlo
 
@@ -13,17 +13,17 @@ namespace Dory::Search {
         static constexpr int Large = 1000000;
         static constexpr int NumKillers = 4;
 
-        std::array<std::array<Move, NumKillers>, 128> killerMoves{};
+        std::array<std::array<PackedMove, NumKillers>, 128> killerMoves{};
         std::array<int, 128> kmPositions{};
 
     public:
-        Move priorityMove{NULLMOVE};
+        PackedMove priorityMove{NULLPACKEDMOVE};
 
         void reset() {
             kmPositions.fill(0);
         }
 
-        void addKillerMove(Move move, int depth) {
+        void addKillerMove(PackedMove move, int depth) {
             killerMoves[depth][kmPositions[depth]++] = move;
             kmPositions[depth] %= NumKillers;
         }
@@ -35,20 +35,17 @@ namespace Dory::Search {
             const int fromIndex = firstBitOf(from);
             const int toIndex   = firstBitOf(to);
             const bool isCapture = to & board.enemyPieces<whiteToMove>();
+            const PackedMove move{static_cast<uint8_t>(fromIndex), static_cast<uint8_t>(toIndex), flags};
 
             // Priority move
-            if (priorityMove.is<piece, flags>(from, to)) {
+            if (priorityMove == move) {
                 heuristic_val += Large * 8;
             }
 
             // Captures
             if (isCapture) {
-                int victimValue = 0;
-                if (board.enemyPawns<whiteToMove>() & to)      victimValue = 100;
-                else if (board.enemyKnights<whiteToMove>() & to) victimValue = 300;
-                else if (board.enemyBishops<whiteToMove>() & to) victimValue = 300;
-                else if (board.enemyRooks<whiteToMove>() & to)   victimValue = 500;
-                else if (board.enemyQueens<whiteToMove>() & to)  victimValue = 900;
+                static constexpr int victimValues[7] = {900, 500, 300, 300, 100, 0, 0}; // indexed by Piece_t
+                int victimValue = victimValues[board.pieceAt(toIndex)];
 
                 int attackerValue = pieceValue<piece>();
                 heuristic_val += Large + (victimValue - attackerValue); // MVV-LVA
@@ -60,7 +57,7 @@ namespace Dory::Search {
             // Killer moves
             if (!isCapture) {
                 for (int i = 0; i < kmPositions[depth]; i++) {
-                    if (killerMoves[depth][i].is<piece, flags>(from, to)) {
+                    if (killerMoves[depth][i] == move) {
                         heuristic_val += Large / (i + 1); // first killer higher
                     }
                 }
@@ -0,0 +1,135 @@
+#ifndef DORY_REPORTER_H
+#define DORY_REPORTER_H
+
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+#include "../core/board.h"
+#include "../utils/utils.h"
+
+namespace Dory::Search {
+
+    /// Progress of the iterative deepening after a completed depth. The line holds the first move last.
+    struct IterationInfo {
+        int depth;
+        int eval;
+        const std::vector<Move>& line;
+        uint64_t nodes;     // total of the search so far
+        double seconds;     // since the search started
+    };
+
+    /**
+     * Receives the progress of a search. The search calls it once per depth, nothing is formatted unless a reporter
+     * writes it somewhere.
+     */
+    class InfoReporter {
+    public:
+        virtual ~InfoReporter() = default;
+
+        virtual void iterationStarted([[maybe_unused]] int depth, [[maybe_unused]] int alpha, [[maybe_unused]] int beta) {}
+
+        virtual void iterationFinished([[maybe_unused]] const IterationInfo& info) {}
+    };
+
+    /// Discards all output, the default of every Searcher
+    class NullReporter final : public InfoReporter {};
+
+    NullReporter& nullReporter() {
+        static NullReporter instance;
+        return instance;
+    }
+
+    namespace detail {
+        /// Writes a move in coordinate notation like "e7e8q", returns the end of the written characters
+        char* writeMove(Move move, char* out) {
+            static constexpr char promotions[] = "qrbn";
+            *out++ = static_cast<char>('a' + fileOf(move.fromIndex));
+            *out++ = static_cast<char>('1' + rankOf(move.fromIndex));
+            *out++ = static_cast<char>('a' + fileOf(move.toIndex));
+            *out++ = static_cast<char>('1' + rankOf(move.toIndex));
+            if (move.flags >= MOVEFLAG_PromoteQueen && move.flags <= MOVEFLAG_PromoteKnight) {
+                *out++ = promotions[move.flags - MOVEFLAG_PromoteQueen];
+            }
+            return out;
+        }
+
+        void writeLine(std::ostream& out, const std::vector<Move>& line) {
+            char buffer[6];
+            for (size_t i = line.size(); i-- > 0;) {
+                char* end = writeMove(line[i], buffer);
+                out << std::string_view{buffer, static_cast<size_t>(end - buffer)};
+                if (i) out << ' ';
+            }
+        }
+
+        /// Mates are given in moves from the view of the side to move
+        void writeScore(std::ostream& out, int eval, std::string_view cp, std::string_view mate) {
+            if (eval > INF - 50) out << mate << (INF - eval + 1) / 2;
+            else if (eval < -(INF - 50)) out << mate << -(INF + eval + 1) / 2;
+            else out << cp << eval;
+        }
+    }
+
+    /**
+     * The human-readable progress output of the command line tool.
+     */
+    class ConsoleReporter final : public InfoReporter {
+        std::ostream& out;
+
+    public:
+        explicit ConsoleReporter(std::ostream& stream) : out{stream} {}
+
+        void iterationStarted(int depth, int alpha, int beta) override {
+            out << "Searching Depth " << depth << "    (" << alpha << " / " << beta << ")\n";
+        }
+
+        void iterationFinished(const IterationInfo& info) override {
+            out << Utils::parseEval(info.eval) << ":  ";
+            for (size_t i = info.line.size(); i-- > 0;) out << Utils::moveNameShortNotation(info.line[i]) << " ";
+            out << '\n' << (static_cast<double>(info.nodes) / 1000000) / info.seconds << " M nodes / second\t\t["
+                << info.nodes << " nodes in " << info.seconds << " sec]\n\n";
+        }
+    };
+
+    /**
+     * Writes "info" lines of the UCI protocol. The stream is not flushed, the "bestmove" line flushes it.
+     */
+    class UciReporter final : public InfoReporter {
+        std::ostream& out;
+
+    public:
+        explicit UciReporter(std::ostream& stream) : out{stream} {}
+
+        void iterationFinished(const IterationInfo& info) override {
+            const auto ms = static_cast<uint64_t>(info.seconds * 1000);
+            out << "info depth " << info.depth << ' ';
+            detail::writeScore(out, info.eval, "score cp ", "score mate ");
+            out << " nodes " << info.nodes << " nps " << static_cast<uint64_t>(info.nodes / std::max(info.seconds, 1e-3))
+                << " time " << ms << " pv ";
+            detail::writeLine(out, info.line);
+            out << '\n';
+        }
+    };
+
+    /**
+     * Writes one JSON object per completed depth and line.
+     */
+    class JsonReporter final : public InfoReporter {
+        std::ostream& out;
+
+    public:
+        explicit JsonReporter(std::ostream& stream) : out{stream} {}
+
+        void iterationFinished(const IterationInfo& info) override {
+            out << R"({"depth":)" << info.depth << ',';
+            detail::writeScore(out, info.eval, R"("cp":)", R"("mate":)");
+            out << R"(,"nodes":)" << info.nodes << R"(,"timeMs":)" << info.seconds * 1000 << R"(,"pv":")";
+            detail::writeLine(out, info.line);
+            out << "\"}\n";
+        }
+    };
+
+} // namespace Dory::Search
+
+#endif //DORY_REPORTER_H
@@ -5,6 +5,9 @@
 #ifndef DORY_SEARCH_H
 #define DORY_SEARCH_H
 
+#include <algorithm>
+#include <span>
+
 #include "evaluation.h"
 #include "../utils/utils.h"
 #include "../utils/zobrist.h"
@@ -12,6 +15,11 @@
 #include "../core/movecollectors.h"
 #include "moveordering.h"
 #include "tables.h"
+#include "tablebases.h"
+#include "syzygy.h"
+#include "searchstats.h"
+#include "reporter.h"
+#include "searchtrace.h"
 #include "../utils/timer.h"
 
 namespace Dory {
@@ -24,16 +32,18 @@ namespace Dory {
 
     namespace Search {
 
-        struct WeightedMove {
-            Move move{};
-            int weight{0};
-
-            bool operator>(const WeightedMove& other) const { return weight > other.weight; }
+        // Principal variations inside the search hold packed moves, stored in reverse order like Line
+        using PackedLine = std::vector<PackedMove>;
+        struct SearchResult {
+            int eval{};
+            PackedLine line{};
         };
 
 //        template<size_t stacksize, size_t maxdepth>
         class MoveContainer {
-            std::array<WeightedMove, 2048> moves{};
+            // Scores are kept apart from the moves, so sorting scans a dense array of ints
+            std::array<Move, 2048> moves{};
+            std::array<int, 2048> scores{};
             std::array<size_t, 128> starts{};
             const MoveOrderer* moveOrderer;
             size_t currentDepth{}, ix{};
@@ -61,10 +71,8 @@ namespace Dory {
 
             template<bool whiteToMove,  Piece_t piece, Flag_t flags>
             inline void nextMove(Board& board, BB from, BB to) {
-                moves.at(ix++) = {
-                    createMoveFromBB(from, to, piece, flags),
-                    moveOrderer->moveHeuristic<whiteToMove, piece, flags>(board, from, to, pd, currentDepth)
-                };
+                scores.at(ix) = moveOrderer->moveHeuristic<whiteToMove, piece, flags>(board, from, to, pd, currentDepth);
+                moves[ix++] = createMoveFromBB(from, to, piece, flags);
             }
 
             [[nodiscard]] auto begin(size_t depth) const { return moves.begin() + starts[depth]; }
@@ -72,7 +80,21 @@ namespace Dory {
             [[nodiscard]] bool empty(size_t depth) const { return starts[depth] == starts[depth+1]; }
 
             // Modifiers
-            void sort(size_t depth) { std::sort(moves.begin() + starts[depth], moves.begin() + starts[depth+1], std::greater<>()); }
+            void sort(size_t depth) {
+                // Insertion sort by descending score, move lists are short
+                const size_t first = starts[depth], last = starts[depth+1];
+                for (size_t i = first + 1; i < last; i++) {
+                    const Move move = moves[i];
+                    const int score = scores[i];
+                    size_t j = i;
+                    for (; j > first && scores[j-1] < score; j--) {
+                        moves[j] = moves[j-1];
+                        scores[j] = scores[j-1];
+                    }
+                    moves[j] = move;
+                    scores[j] = score;
+                }
+            }
             void reset() { starts.fill(0); }
         };
 
@@ -82,6 +104,24 @@ namespace Dory {
         const int NUM_PV_NODES = 2;
         const int NUM_FULL_DEPTH_NODES = 4;
 
+        /**
+         * Budget for one search. Node and time limits of 0 are unlimited, the first depth is always completed.
+         */
+        struct SearchLimits {
+            int depth{MAX_ITER_DEPTH};
+            uint64_t nodes{0};
+            long timeMs{0};
+        };
+
+        /**
+         * Positions with at most 'probeLimit' pieces and no castling rights are looked up in the endgame tablebases,
+         * inside the tree only while at least 'probeDepth' plies remain.
+         */
+        struct TablebaseOptions {
+            int probeDepth{1};
+            int probeLimit{32};
+        };
+
         class Searcher {
             TranspositionTable trTable{};
             RepetitionTable repTable{};
@@ -90,10 +130,29 @@ namespace Dory {
 
         public:
             BB nodesSearched{0}, tableLookups{0};
+            BB tbProbes{0}, tbHits{0};
+            TablebaseOptions tbOptions{};
+            SearchStats stats{};
             Move bestMove;
+            InfoReporter* reporter{&nullReporter()};   // progress of the iterative deepening, never null
+            SearchTrace* trace{nullptr};                // records the tree of the next searches if set
+            int depthReached{0};
+
+            template<bool whiteToMove>
+            Result iterativeDeepening(Board &board, SearchLimits searchLimits);
 
             template<bool whiteToMove>
-            Result iterativeDeepening(Board &board, int maxDepth = MAX_ITER_DEPTH);
+            Result iterativeDeepening(Board &board, int maxDepth = MAX_ITER_DEPTH) {
+                return iterativeDeepening<whiteToMove>(board, SearchLimits{maxDepth});
+            }
+
+            /**
+             * Positions played before the next search root, oldest first. Repetitions of them are scored as draws,
+             * they are kept until the history is set again.
+             */
+            void setGameHistory(std::span<const uint64_t> hashes) {
+                repTable.setGameHistory(hashes);
+            }
 
             void reset() {
                 trTable.reset();
@@ -101,19 +160,48 @@ namespace Dory {
                 moveOrderer.reset();
                 moveContainer.reset();
                 nodesSearched = tableLookups = 0;
+                tbProbes = tbHits = 0;
+                stats.reset();
+                rootMoves.clear();
+                bestMove = NULLMOVE;
+                depthReached = 0;
+                stopped = false;
             }
 
+            void reserveTable(size_t mb) { trTable.reserve(mb); }
+
             [[nodiscard]] size_t trTableSizeKb() const { return trTable.size(); }
 
             [[nodiscard]] size_t trTableSizeMb() const { return trTable.size() / 1024; }
 
         private:
+            SearchLimits limits{};
+            Timer timer{};
+            bool stopped{false};
+            std::vector<PackedMove> rootMoves;   // if not empty, the only root moves searched
+
+            [[nodiscard]] bool tbApplies(const Board& board) const {
+                const int pieces = bitCount(board.occ());
+                return pieces <= tbOptions.probeLimit && pieces <= Tablebases::maxPieces() && !board.castlingRights();
+            }
+
+            template<bool whiteToMove>
+            void filterRootMoves(Board& board);
+
+            /// Only polled every 1024 nodes and never before the first depth is complete
+            bool outOfBudget() {
+                if (stopped) return true;
+                if (depthReached == 0 || (nodesSearched & 1023) != 0) return false;
+                stopped = (limits.nodes && nodesSearched >= limits.nodes)
+                        || (limits.timeMs && timer.timeMillis() >= limits.timeMs);
+                return stopped;
+            }
 
             template<bool whiteToMove, bool topLevel>
-            Result negamax(Board &board, int depth, int alpha, int beta, int maxDepth);
+            SearchResult negamax(Board &board, int depth, int alpha, int beta, int maxDepth);
 
             template<bool whiteToMove>
-            Result quiescenceSearch(Board &board, int depth, int alpha, int beta);
+            SearchResult quiescenceSearch(Board &board, int depth, int alpha, int beta);
 
         }; // class Searcher
 
@@ -121,30 +209,54 @@ namespace Dory {
             return eval > INF - 50 || eval < -(INF - 50);
         }
 
+        /**
+         * Expands a packed principal variation by replaying it from the root position.
+         */
+        template<bool whiteToMove>
+        Line unpackLine(Board board, const PackedLine& packedLine) {
+            Line line(packedLine.size());
+            bool white = whiteToMove;
+            for (size_t i = packedLine.size(); i-- > 0;) {
+                line[i] = board.unpack(packedLine[i]);
+                board.makeMove(line[i], white);
+                white = !white;
+            }
+            return line;
+        }
+
         template<bool whiteToMove>
-        Result Searcher::iterativeDeepening(Board &board, int maxDepth) {
+        Result Searcher::iterativeDeepening(Board &board, SearchLimits searchLimits) {
             Result bestResult{};
             int alpha, beta;
             reset();
+            limits = searchLimits;
+            if (trace) trace->clear();
 
-            Timer t;
-            t.start();
+            timer.start();
+            filterRootMoves<whiteToMove>(board);
 
-            for (int depth = 1; depth <= maxDepth; depth++) {
+            for (int depth = 1; depth <= limits.depth; depth++) {
                 int window = ASP_WINDOW_SIZE;
                 alpha = (depth == 1) ? -INF : bestResult.eval - window;
                 beta  = (depth == 1) ?  INF : bestResult.eval + window;
 
-                std::cout << "Searching Depth " << depth << "    (" << alpha << " / " << beta << ")" << std::endl;
+                reporter->iterationStarted(depth, alpha, beta);
 
                 int windowIncreases = MAX_WINDOW_INCREASES;
-                Result result{};
+                SearchResult result{};
                 bool doFullSearch = false;
+                const uint64_t nodesBefore = nodesSearched;
+                const double iterationStart = timer.timeSeconds();
+                stats.beginIteration(depth);
+                if (trace) trace->beginIteration(depth);
 
                 while (windowIncreases--) {
+                    if constexpr (COLLECT_STATS) {
+                        if (windowIncreases + 1 < MAX_WINDOW_INCREASES) stats.current.aspirationResearches++;
+                    }
                     result = negamax<whiteToMove, true>(board, 0, alpha, beta, depth);
 
-                    if (isMateEval(result.eval)) break;
+                    if (stopped || isMateEval(result.eval)) break;
 
                     if (result.eval <= alpha) {
                         alpha -= window;
@@ -159,34 +271,107 @@ namespace Dory {
                     window *= 2;
                 }
 
-                if (doFullSearch) {
+                if (doFullSearch && !stopped) {
+                    if constexpr (COLLECT_STATS) stats.current.aspirationResearches++;
                     result = negamax<whiteToMove, true>(board, 0, -INF, INF, depth);
                 }
 
-                bestResult = std::move(result);
-                Utils::printLine(bestResult.line, bestResult.eval);
+                stats.endIteration(!stopped, nodesSearched - nodesBefore, 1000 * (timer.timeSeconds() - iterationStart));
+
+                // the result of an interrupted depth is incomplete, keep the previous one
+                if (stopped) break;
 
-                auto s = t.timeSeconds();
-                std::cout << (static_cast<double>(nodesSearched) / 1000000) / s << " M nodes / second\t\t[" << nodesSearched << " nodes in " << s << " sec]\n" << std::endl;
+                depthReached = depth;
+                bestResult = {result.eval, unpackLine<whiteToMove>(board, result.line)};
+                reporter->iterationFinished({depth, bestResult.eval, bestResult.line, nodesSearched, timer.timeSeconds()});
             }
 
             return bestResult;
         }
 
+        /**
+         * If the root is in the tablebases, only moves that keep its result are searched. Syzygy DTZ tables also rank
+         * them by the distance to zeroing the 50 move counter, otherwise the search still has to find the way to
+         * convert a win among them.
+         */
+        template<bool whiteToMove>
+        void Searcher::filterRootMoves(Board& board) {
+            if (!tbApplies(board)) return;
+
+            MoveCollectors::MoveList list;
+            list.generate<whiteToMove>(board);
+            std::vector<std::pair<Move, int>> results;
+            tbProbes += list.count;
+            if (bitCount(board.occ()) <= Syzygy::maxPieces() && Syzygy::rankRootMoves<whiteToMove>(board, list, results)) {
+                tbHits += list.count;
+            } else {
+                results.clear();
+                for (const Move& move: list) {
+                    Board next = board.fork<whiteToMove>(move);
+                    const Tablebases::WDL wdl = Tablebases::probeWDL(next, !whiteToMove);
+                    if (wdl == Tablebases::WDL_Unknown) return;
+                    tbHits++;
+                    results.emplace_back(move, -wdl);
+                }
+            }
+            if (results.empty()) return;
+
+            const int best = std::max_element(results.begin(), results.end(),
+                                              [](auto& a, auto& b) { return a.second < b.second; })->second;
+            for (auto& [move, rank]: results) {
+                if (rank == best) rootMoves.emplace_back(move);
+            }
+        }
+
         template<bool whiteToMove, bool topLevel>
-        Result Searcher::negamax(Board &board, int depth, int alpha, int beta, int maxDepth) {
+        SearchResult Searcher::negamax(Board &board, int depth, int alpha, int beta, int maxDepth) {
             const uint64_t boardHash = Zobrist::hash<whiteToMove>(board);
             nodesSearched++;
 
-            /// Check for Threefold-Repetition
-            if (repTable.check(boardHash)) {
+            if (outOfBudget()) {
                 return {0, {}};
             }
 
-            /// Lookup position in table
+            /// Check for draws by repetition and the 50 move rule, the root is always searched
+            if constexpr (!topLevel) {
+                if (repTable.check(boardHash, board.halfmoveClock)) {
+                    return {0, {}};
+                }
+                if (board.halfmoveClock >= 100) {
+                    // a checkmate delivered with the 100th half-move stands
+                    if (!moveContainer.loadClh<whiteToMove>(board).inCheck()) return {0, {}};
+                    moveContainer.generate<whiteToMove, GC_DEFAULT_NO_CLH>(board, depth);
+                    return {moveContainer.empty(depth) ? -(INF - depth) : 0, {}};
+                }
+            }
+
             int origAlpha = alpha;
             int remainingDepth = maxDepth - depth;
+
+            /// Probe endgame tablebases
+            if constexpr (!topLevel) {
+                if (remainingDepth >= tbOptions.probeDepth && tbApplies(board)) {
+                    tbProbes++;
+                    const Tablebases::WDL wdl = Tablebases::probeWDL(board, whiteToMove);
+                    if (wdl != Tablebases::WDL_Unknown) {
+                        tbHits++;
+                        return {Tablebases::score(wdl, depth), {}};
+                    }
+                }
+            }
+
+            /// Neither side can mate
+            if constexpr (!topLevel) {
+                if (board.insufficientMaterial()) return {0, {}};
+            }
+
+            /// Lookup position in table
             auto [ttEntry, resultValid] = trTable.lookup(boardHash, alpha, beta, remainingDepth);
+            if constexpr (COLLECT_STATS) {
+                stats.current.ttProbes++;
+                stats.current.ttHits += TranspositionTable::found(ttEntry);
+                stats.current.ttCutoffs += resultValid;
+            }
             if (resultValid) {
                 tableLookups++;
                 return {ttEntry.value, {}};
@@ -203,9 +388,9 @@ namespace Dory {
             /// Generate legal moves
             // Set move that is searched first
             if constexpr (topLevel) {
-                moveOrderer.priorityMove = bestMove;
+                moveOrderer.priorityMove = PackedMove{bestMove};
             } else {
-                // ttEntry.move may be NULLMOVE, but that does not hurt us
+                // ttEntry.move may be NULLPACKEDMOVE, but that does not hurt us
                 moveOrderer.priorityMove = ttEntry.move;
             }
 
@@ -218,11 +403,11 @@ namespace Dory {
                 if (inCheck) {
                     // Checkmate!
                     int eval = -(INF - depth);
-                    trTable.insert(boardHash, eval, NULLMOVE, remainingDepth, origAlpha, beta);
+                    trTable.insert(boardHash, eval, NULLPACKEDMOVE, remainingDepth, origAlpha, beta);
                     return {eval, {}};
                 } else {
                     // Stalemate!
-                    trTable.insert(boardHash, 0, NULLMOVE, remainingDepth, origAlpha, beta);
+                    trTable.insert(boardHash, 0, NULLPACKEDMOVE, remainingDepth, origAlpha, beta);
                     return {0, {}};
                 }
             }
@@ -230,8 +415,8 @@ namespace Dory {
             moveContainer.sort(depth);
 
             // Iterate all moves
-            Line localBestLine;
-            Move localBestMove;
+            PackedLine localBestLine;
+            PackedMove localBestMove;
 //            Board nextBoard;
             int bestEval = -INF;
 
@@ -248,9 +433,18 @@ namespace Dory {
             /// Iterate through all moves
             int moveIx = 0;
             for(auto it = moveContainer.begin(depth); it != moveContainer.end(depth); ++it) {
-                Move move = (*it).move;
+                Move move = *it;
+                if constexpr (topLevel) {
+                    if (!rootMoves.empty() && std::find(rootMoves.begin(), rootMoves.end(), PackedMove{move}) == rootMoves.end())
+                        continue;
+                }
                 bool isCapture = board.isCapture<whiteToMove>(move);
 
+                const bool traced = trace && trace->sample(depth);
+                const uint64_t nodesBefore = nodesSearched;
+                const int windowAlpha = alpha;
+                bool researched = false;
+
                 repTable.push(boardHash);
                 RestoreInfo ri = board.makeMove<whiteToMove>(move);
 
@@ -263,7 +457,7 @@ namespace Dory {
 //                int mdpt = maxDepth + ext;
 
                 int eval;
-                Line line;
+                PackedLine line;
 
                 // Principal Variation Search
                 if (moveIx == 0) {
@@ -278,6 +472,8 @@ namespace Dory {
 
                     if (tempEval > alpha && tempEval < beta) {
                         // Fail-high → full re-search needed
+                        if constexpr (COLLECT_STATS) stats.current.pvsResearches++;
+                        researched = true;
                         auto [ev2, ln2] = negamax<!whiteToMove, false>(board, depth + 1, -beta, -alpha, mdpt);
                         eval = -ev2;
                         line = ln2;
@@ -290,38 +486,35 @@ namespace Dory {
                 board.unmakeMove<whiteToMove>(move, ri);
                 repTable.pop();
 
-//            if(Zobrist::hash<whiteToMove>(board) == 335140086) {
-//                Line l = std::vector<Move>{move};
-//                std::cout << info << " for " << whiteToMove << " -> ";
-//                Utils::printLine(l,  info);
-//            }
-
-//            for (int i = 0; i < depth; i++)
-//                std::cout << "   ";
-//            std::cout << depth << " : " << Utils::moveNameShortNotation(move) << "  " << eval << std::endl;
-
-//            if constexpr (topLevel) {
-//                Line l = std::vector<Move>{move};
-//                Utils::printLine(l, info);
-//            }
-
                 if (eval > alpha)
                     alpha = eval;
 
                 if (eval > bestEval) {
                     bestEval = eval;
-                    line.push_back(move);
+                    line.emplace_back(move);
                     localBestLine = line;
-                    localBestMove = move;
+                    localBestMove = PackedMove{move};
 
                     if constexpr (topLevel) {
-                        bestMove = move;
+                        if (!stopped) bestMove = move;
                     }
                 }
 
+                if (traced) {
+                    const uint8_t flags = (alpha >= beta ? TRACE_Cutoff : 0) | (researched ? TRACE_Research : 0)
+                                        | (stopped ? TRACE_Interrupted : 0);
+                    trace->record(depth, PackedMove{move}, windowAlpha, beta, eval, nodesSearched - nodesBefore, moveIx,
+                                  flags);
+                }
+
                 if (alpha >= beta) {
+                    if constexpr (COLLECT_STATS) {
+                        stats.current.betaCutoffs++;
+                        stats.current.firstMoveCutoffs += moveIx == 0;
+                        stats.current.cutoffIndexSum += moveIx;
+                    }
                     if(!isCapture)
-                        moveOrderer.addKillerMove(move, depth);
+                        moveOrderer.addKillerMove(PackedMove{move}, depth);
                     break;
                 }
 
@@ -335,8 +528,9 @@ namespace Dory {
         }
 
         template<bool whiteToMove>
-        Result Searcher::quiescenceSearch(Board &board, int depth, int alpha, int beta) {
+        SearchResult Searcher::quiescenceSearch(Board &board, int depth, int alpha, int beta) {
             nodesSearched++;
+            if constexpr (COLLECT_STATS) stats.current.qnodes++;
 
             /// Recursion Base Case: Max Depth reached -> return heuristic position eval
             int standPat = evaluation::evaluatePosition<whiteToMove>(board);
@@ -370,12 +564,12 @@ namespace Dory {
 
             moveContainer.sort(depth);
 
-            Line localBestLine;
+            PackedLine localBestLine;
             Board nextBoard;
 
             /// Iterate through all moves
             for(auto cit = moveContainer.begin(depth); cit != moveContainer.end(depth); ++cit) {
-                Move move = (*cit).move;
+                Move move = *cit;
 
                 nextBoard = board.fork<whiteToMove>(move);
                 auto [eval, line] = quiescenceSearch<!whiteToMove>(nextBoard, depth + 1, -beta, -alpha);
@@ -386,12 +580,12 @@ namespace Dory {
 //            std::cout << depth << " : " << Utils::moveNameShortNotation(move) << "  " << eval << std::endl;
 
                 if (eval >= beta) {
-                    line.push_back(move);
+                    line.emplace_back(move);
                     return { beta, line };
                 }
                 if (eval > alpha) {
                     alpha = eval;
-                    line.push_back(move);
+                    line.emplace_back(move);
                     localBestLine = line;
                 }
             }
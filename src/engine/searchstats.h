@@ -0,0 +1,127 @@
+#ifndef DORY_SEARCHSTATS_H
+#define DORY_SEARCHSTATS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace Dory::Search {
+
+#ifdef DORY_SEARCH_STATS
+    constexpr bool COLLECT_STATS = true;
+#else
+    constexpr bool COLLECT_STATS = false;
+#endif
+
+    /**
+     * Counters of one iteration of the iterative deepening. All counters except 'nodes' stay zero unless the engine
+     * is built with DORY_SEARCH_STATS.
+     */
+    struct IterationStats {
+        int depth{0};
+        bool completed{false};          // false if the search ran out of budget during this iteration
+        uint64_t nodes{0}, qnodes{0};
+        uint64_t ttProbes{0}, ttHits{0}, ttCutoffs{0};
+        uint64_t betaCutoffs{0}, firstMoveCutoffs{0};
+        uint64_t cutoffIndexSum{0};     // sum of the 0-based indices of the moves that caused beta cutoffs
+        uint64_t pvsResearches{0}, aspirationResearches{0};
+        double timeMs{0};
+
+        [[nodiscard]] double firstMoveCutoffRate() const {
+            return betaCutoffs ? static_cast<double>(firstMoveCutoffs) / static_cast<double>(betaCutoffs) : 0;
+        }
+
+        [[nodiscard]] double averageCutoffIndex() const {
+            return betaCutoffs ? static_cast<double>(cutoffIndexSum) / static_cast<double>(betaCutoffs) : 0;
+        }
+
+        IterationStats& operator+=(const IterationStats& other) {
+            depth = std::max(depth, other.depth);
+            nodes += other.nodes;
+            qnodes += other.qnodes;
+            ttProbes += other.ttProbes;
+            ttHits += other.ttHits;
+            ttCutoffs += other.ttCutoffs;
+            betaCutoffs += other.betaCutoffs;
+            firstMoveCutoffs += other.firstMoveCutoffs;
+            cutoffIndexSum += other.cutoffIndexSum;
+            pvsResearches += other.pvsResearches;
+            aspirationResearches += other.aspirationResearches;
+            timeMs += other.timeMs;
+            return *this;
+        }
+    };
+
+    /**
+     * Statistics of the last search, one entry per started iteration.
+     */
+    struct SearchStats {
+        std::vector<IterationStats> iterations;
+        IterationStats current;
+
+        void reset() {
+            iterations.clear();
+            current = {};
+        }
+
+        void beginIteration(int depth) {
+            current = {};
+            current.depth = depth;
+        }
+
+        void endIteration(bool completed, uint64_t nodes, double timeMs) {
+            current.completed = completed;
+            current.nodes = nodes;
+            current.timeMs = timeMs;
+            iterations.push_back(current);
+        }
+
+        [[nodiscard]] IterationStats total() const {
+            IterationStats sum;
+            for (auto& it: iterations) sum += it;
+            sum.completed = !iterations.empty() && iterations.back().completed;
+            return sum;
+        }
+
+        /// Nodes of the last completed iteration divided by the nodes of the one before
+        [[nodiscard]] double branchingFactor() const {
+            const IterationStats* last = nullptr, *previous = nullptr;
+            for (auto& it: iterations) {
+                if (!it.completed) continue;
+                previous = last;
+                last = &it;
+            }
+            return previous && previous->nodes ? static_cast<double>(last->nodes) / static_cast<double>(previous->nodes) : 0;
+        }
+
+        [[nodiscard]] std::string toJSON() const {
+            std::stringstream out;
+            auto write = [&out](const IterationStats& s) {
+                out << R"({"depth":)" << s.depth << R"(,"completed":)" << (s.completed ? "true" : "false")
+                    << R"(,"nodes":)" << s.nodes << R"(,"qnodes":)" << s.qnodes
+                    << R"(,"ttProbes":)" << s.ttProbes << R"(,"ttHits":)" << s.ttHits
+                    << R"(,"ttCutoffs":)" << s.ttCutoffs << R"(,"betaCutoffs":)" << s.betaCutoffs
+                    << R"(,"firstMoveCutoffRate":)" << s.firstMoveCutoffRate()
+                    << R"(,"averageCutoffIndex":)" << s.averageCutoffIndex()
+                    << R"(,"pvsResearches":)" << s.pvsResearches
+                    << R"(,"aspirationResearches":)" << s.aspirationResearches << R"(,"timeMs":)" << s.timeMs << "}";
+            };
+
+            out << R"({"enabled":)" << (COLLECT_STATS ? "true" : "false") << R"(,"branchingFactor":)"
+                << branchingFactor() << R"(,"total":)";
+            write(total());
+            out << R"(,"iterations":[)";
+            for (size_t i = 0; i < iterations.size(); i++) {
+                if (i) out << ',';
+                write(iterations[i]);
+            }
+            out << "]}";
+            return out.str();
+        }
+    };
+
+} // namespace Dory::Search
+
+#endif //DORY_SEARCHSTATS_H
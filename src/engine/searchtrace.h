@@ -0,0 +1,133 @@
+#ifndef DORY_SEARCHTRACE_H
+#define DORY_SEARCHTRACE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../core/chess.h"
+
+namespace Dory::Search {
+
+    enum TraceFlag : uint8_t {
+        TRACE_Cutoff = 1,           // the move caused a beta cutoff
+        TRACE_Research = 2,         // the null window search failed high and the move was searched again
+        TRACE_Interrupted = 4       // the search ran out of budget below this move, the score is meaningless
+    };
+
+    /**
+     * One searched move of negamax. The record is written once the move is unmade, so the records of a subtree
+     * come before the record of the move leading to it. 'nodes' counts the whole subtree including quiescence.
+     */
+    struct TraceRecord {
+        int32_t alpha, beta;        // window of the parent node when the move was searched
+        int32_t score;              // from the view of the side that made the move
+        uint32_t nodes;             // saturates at UINT32_MAX
+        PackedMove move;
+        uint8_t iteration;          // depth of the iterative deepening iteration
+        uint8_t ply;                // 0 for root moves
+        uint8_t moveIndex;          // position in the move ordering, the cutoff index if TRACE_Cutoff is set
+        uint8_t flags;
+        uint8_t padding[2]{};
+    };
+    static_assert(sizeof(TraceRecord) == 24);
+
+    /**
+     * Records are only taken up to 'maxPly'. Root moves are always recorded, deeper moves with a chance of
+     * 1 / 'sampleRate'. Recording stops after 'maxRecords'.
+     */
+    struct TraceOptions {
+        int maxPly{4};
+        uint32_t sampleRate{1};
+        size_t maxRecords{1 << 22};
+    };
+
+    /**
+     * Sampled trace of the search tree for offline analysis with the traceview tool. Searchers only touch it if
+     * one is attached, the cost of a search without trace is a single predictable branch per move.
+     */
+    class SearchTrace {
+        static constexpr char MAGIC[8] = {'D', 'O', 'R', 'Y', 'T', 'R', 'C', '1'};
+
+        std::vector<TraceRecord> trace;
+        TraceOptions options;
+        uint64_t rng{0x9E3779B97F4A7C15ull};   // fixed seed, the same search gives the same trace
+        uint8_t iteration{0};
+
+    public:
+        explicit SearchTrace(TraceOptions opts = {}) : options{opts} {}
+
+        void clear() {
+            trace.clear();
+            iteration = 0;
+        }
+
+        void beginIteration(int depth) { iteration = static_cast<uint8_t>(depth); }
+
+        /// Whether the move about to be searched at 'ply' is recorded
+        [[nodiscard]] bool sample(int ply) {
+            if (ply > options.maxPly || trace.size() >= options.maxRecords) return false;
+            if (ply == 0 || options.sampleRate <= 1) return true;
+            rng ^= rng << 13;   // xorshift64
+            rng ^= rng >> 7;
+            rng ^= rng << 17;
+            return rng % options.sampleRate == 0;
+        }
+
+        void record(int ply, PackedMove move, int alpha, int beta, int score, uint64_t nodes, int moveIndex,
+                    uint8_t flags) {
+            if (trace.size() >= options.maxRecords) return;     // filled by the subtree of a sampled move
+            TraceRecord& r = trace.emplace_back();
+            r.alpha = alpha;
+            r.beta = beta;
+            r.score = score;
+            r.nodes = static_cast<uint32_t>(std::min<uint64_t>(nodes, UINT32_MAX));
+            r.move = move;
+            r.iteration = iteration;
+            r.ply = static_cast<uint8_t>(ply);
+            r.moveIndex = static_cast<uint8_t>(std::min(moveIndex, 255));
+            r.flags = flags;
+        }
+
+        [[nodiscard]] const std::vector<TraceRecord>& records() const { return trace; }
+
+        [[nodiscard]] const TraceOptions& traceOptions() const { return options; }
+
+        /// Magic, the options and the record count, followed by the raw records in host byte order
+        bool save(const std::string& path) const {
+            std::ofstream out(path, std::ios::binary);
+            const uint32_t header[2] = {static_cast<uint32_t>(options.maxPly), options.sampleRate};
+            const uint64_t count = trace.size();
+            out.write(MAGIC, sizeof(MAGIC));
+            out.write(reinterpret_cast<const char*>(header), sizeof(header));
+            out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+            out.write(reinterpret_cast<const char*>(trace.data()),
+                      static_cast<std::streamsize>(trace.size() * sizeof(TraceRecord)));
+            return static_cast<bool>(out);
+        }
+
+        /// Reads a trace written by save(), false if the file is not a complete trace
+        bool load(const std::string& path) {
+            std::ifstream in(path, std::ios::binary);
+            char magic[sizeof(MAGIC)];
+            uint32_t header[2];
+            uint64_t count;
+            in.read(magic, sizeof(magic));
+            in.read(reinterpret_cast<char*>(header), sizeof(header));
+            in.read(reinterpret_cast<char*>(&count), sizeof(count));
+            if (!in || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || count > UINT32_MAX) return false;
+
+            options.maxPly = static_cast<int>(header[0]);
+            options.sampleRate = header[1];
+            trace.resize(count);
+            in.read(reinterpret_cast<char*>(trace.data()), static_cast<std::streamsize>(count * sizeof(TraceRecord)));
+            return in.gcount() == static_cast<std::streamsize>(count * sizeof(TraceRecord));
+        }
+    };
+
+} // namespace Dory::Search
+
+#endif //DORY_SEARCHTRACE_H
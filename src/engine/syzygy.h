@@ -0,0 +1,815 @@
+#ifndef DORY_SYZYGY_H
+#define DORY_SYZYGY_H
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../core/movecollectors.h"
+#include "../utils/pgn.h"
+#include "tablebases.h"
+
+namespace Dory::Syzygy {
+
+    using Tablebases::MaterialKey;
+
+    constexpr int MAX_PIECES = 7;
+
+    /// WDL values of the tables from the view of the side to move. Cursed wins and blessed losses are draws by the 50 move rule.
+    enum : int {
+        SCORE_Loss = -2, SCORE_BlessedLoss = -1, SCORE_Draw = 0, SCORE_CursedWin = 1, SCORE_Win = 2
+    };
+
+    enum ProbeState : uint8_t {
+        PROBE_Fail,             // a table is missing
+        PROBE_Ok,
+        PROBE_ChangeSide,       // the DTZ table only stores the other side to move
+        PROBE_ZeroingBest       // the best move is a capture or pawn move, the DTZ table may hold any value
+    };
+
+    namespace detail {
+        constexpr uint8_t WDL_MAGIC[4] = {0x71, 0xE8, 0x23, 0x5D};
+        constexpr uint8_t DTZ_MAGIC[4] = {0xD7, 0x66, 0x0C, 0xA5};
+
+        enum TableFlag : uint8_t {
+            FLAG_Stm = 1, FLAG_Mapped = 2, FLAG_WinPlies = 4, FLAG_LossPlies = 8, FLAG_Wide = 16, FLAG_SingleValue = 128
+        };
+
+        // Piece_t to the piece codes of the files, pawn 1 to king 6, black pieces have bit 3 set
+        constexpr uint8_t PIECE_CODES[6] = {5, 4, 3, 2, 1, 6};
+
+        /// Negative below the a1-h8 diagonal, positive above it
+        constexpr int offDiagonal(int sq) { return rankOf(sq) - fileOf(sq); }
+
+        /**
+         * Lookup tables of the position encoding. Pawnless positions are mirrored until the leading pieces stand in
+         * the a1-d1-d4 triangle, positions with pawns until the leading pawn is on the files a to d.
+         */
+        struct Encoding {
+            int mapB1H1H7[64]{};            // squares below the a1-h8 diagonal to 0..27
+            int mapA1D1D4[64]{};            // the a1-d1-d4 triangle to 0..9, diagonal squares last
+            int mapKK[10][64]{};            // the 462 placements of two kings with the first one in the triangle
+            int mapPawns[64]{};             // a2-h7 to 47..0, the leading pawn has the highest value
+            uint64_t leadPawnIdx[6][64]{};
+            uint64_t leadPawnsSize[6][4]{};
+            uint64_t binomial[6][64]{};     // binomial[k][n] ways to choose k of n squares
+        };
+
+        constexpr Encoding makeEncoding() {
+            Encoding e{};
+            int code = 0;
+            for (int sq = 0; sq < 64; sq++) {
+                if (offDiagonal(sq) < 0) e.mapB1H1H7[sq] = code++;
+            }
+
+            code = 0;
+            int diagonal[4]{}, numDiagonal = 0;
+            for (int sq = 0; sq < 28; sq++) {
+                if (fileOf(sq) > 3) continue;
+                if (offDiagonal(sq) < 0) e.mapA1D1D4[sq] = code++;
+                else if (offDiagonal(sq) == 0) diagonal[numDiagonal++] = sq;
+            }
+            for (int i = 0; i < numDiagonal; i++) e.mapA1D1D4[diagonal[i]] = code++;
+
+            // kings that do not touch, if the first one is on the diagonal the second one is not above it
+            auto distance = [](int a, int b) { return a > b ? a - b : b - a; };
+            int bothOnDiagonal[64][2]{}, numBoth = 0;
+            code = 0;
+            for (int idx = 0; idx < 10; idx++) {
+                for (int s1 = 0; s1 < 28; s1++) {
+                    if (fileOf(s1) > 3 || offDiagonal(s1) > 0 || e.mapA1D1D4[s1] != idx) continue;
+                    for (int s2 = 0; s2 < 64; s2++) {
+                        if (distance(fileOf(s1), fileOf(s2)) <= 1 && distance(rankOf(s1), rankOf(s2)) <= 1) continue;
+                        if (offDiagonal(s1) == 0 && offDiagonal(s2) > 0) continue;
+                        if (offDiagonal(s1) == 0 && offDiagonal(s2) == 0) {
+                            bothOnDiagonal[numBoth][0] = idx;
+                            bothOnDiagonal[numBoth++][1] = s2;
+                        } else {
+                            e.mapKK[idx][s2] = code++;
+                        }
+                    }
+                }
+            }
+            for (int i = 0; i < numBoth; i++) e.mapKK[bothOnDiagonal[i][0]][bothOnDiagonal[i][1]] = code++;
+
+            e.binomial[0][0] = 1;
+            for (int n = 1; n < 64; n++) {
+                for (int k = 0; k < 6 && k <= n; k++) {
+                    e.binomial[k][n] = (k > 0 ? e.binomial[k - 1][n - 1] : 0) + (k < n ? e.binomial[k][n - 1] : 0);
+                }
+            }
+
+            int available = 47;
+            for (int leadPawns = 1; leadPawns <= 5; leadPawns++) {
+                for (int file = 0; file < 4; file++) {
+                    uint64_t idx = 0;
+                    for (int rank = 1; rank <= 6; rank++) {
+                        const int sq = 8 * rank + file;
+                        if (leadPawns == 1) {
+                            e.mapPawns[sq] = available--;
+                            e.mapPawns[sq ^ 7] = available--;
+                        }
+                        e.leadPawnIdx[leadPawns][sq] = idx;
+                        idx += e.binomial[leadPawns - 1][e.mapPawns[sq]];
+                    }
+                    e.leadPawnsSize[leadPawns][file] = idx;
+                }
+            }
+            return e;
+        }
+
+        constexpr Encoding ENCODING = makeEncoding();
+
+        template<typename T>
+        T readLE(const uint8_t* p) {
+            T value;
+            std::memcpy(&value, p, sizeof(T));
+            return value;
+        }
+
+        inline uint32_t readBE32(const uint8_t* p) { return __builtin_bswap32(readLE<uint32_t>(p)); }
+
+        inline uint64_t readBE64(const uint8_t* p) { return __builtin_bswap64(readLE<uint64_t>(p)); }
+
+        /**
+         * One compressed table: the values of all position indices in blocks of canonical Huffman codes. A symbol
+         * stands for a value or for a pair of symbols (recursive pairing), so one code can expand to many values.
+         */
+        struct PairsData {
+            uint8_t flags{0};
+            int minSymLen{0};                       // the value of single value tables
+            size_t blockSize{0}, span{0};           // every 'span' values there is a sparse index entry
+            size_t sparseIndexSize{0}, blockLengthSize{0};
+            uint32_t numBlocks{0};
+            const uint8_t* sparseIndex{nullptr};    // block and offset of the value at k * span + span / 2, 6 bytes each
+            const uint8_t* blockLength{nullptr};    // number of values of every block minus one
+            const uint8_t* lowestSym{nullptr};      // lowest symbol of every code length
+            const uint8_t* btree{nullptr};          // the two symbols a symbol expands to, 12 bits each
+            const uint8_t* data{nullptr};
+            std::vector<uint64_t> base64;           // lowest code of every length, left aligned to 64 bits
+            std::vector<uint8_t> symLen;            // number of values a symbol expands to minus one
+            uint8_t pieces[MAX_PIECES]{};           // piece codes in the order of the encoding
+            int groupLen[MAX_PIECES + 1]{};         // pieces encoded together, zero terminated
+            uint64_t groupIdx[MAX_PIECES + 1]{};    // index factor of every group, the last one is the table size
+            uint16_t mapIdx[4]{};                   // DTZ value maps of wins, losses, cursed wins and blessed losses
+
+            [[nodiscard]] int left(int sym) const { return ((btree[3 * sym + 1] & 0xF) << 8) | btree[3 * sym]; }
+
+            [[nodiscard]] int right(int sym) const { return (btree[3 * sym + 2] << 4) | (btree[3 * sym + 1] >> 4); }
+
+            [[nodiscard]] int length(uint32_t block) const { return readLE<uint16_t>(blockLength + 2 * block); }
+
+            [[nodiscard]] uint64_t size() const {
+                int n = 0;
+                while (groupLen[n]) n++;
+                return groupIdx[n];
+            }
+
+            uint8_t expandedLength(int sym, std::vector<bool>& visited) {
+                visited[sym] = true;
+                const int r = right(sym);
+                if (r == 0xFFF) return 0;
+                const int l = left(sym);
+                if (!visited[l]) symLen[l] = expandedLength(l, visited);
+                if (!visited[r]) symLen[r] = expandedLength(r, visited);
+                return symLen[l] + symLen[r] + 1;
+            }
+
+            /// Reads the code description, returns the first byte behind it
+            const uint8_t* setSizes(const uint8_t* p) {
+                flags = *p++;
+                if (flags & FLAG_SingleValue) {
+                    minSymLen = *p++;
+                    return p;
+                }
+                blockSize = size_t{1} << *p++;
+                span = size_t{1} << *p++;
+                sparseIndexSize = (size() + span - 1) / span;
+                const uint8_t padding = *p++;
+                numBlocks = readLE<uint32_t>(p);
+                p += 4;
+                blockLengthSize = numBlocks + padding;
+                const int maxSymLen = *p++;
+                minSymLen = *p++;
+                lowestSym = p;
+
+                // longer codes have lower values, base64[i] is the lowest code of length minSymLen + i
+                base64.assign(maxSymLen - minSymLen + 1, 0);
+                for (int i = static_cast<int>(base64.size()) - 2; i >= 0; i--) {
+                    base64[i] = (base64[i + 1] + readLE<uint16_t>(lowestSym + 2 * i)
+                                 - readLE<uint16_t>(lowestSym + 2 * i + 2)) / 2;
+                }
+                for (size_t i = 0; i < base64.size(); i++) base64[i] <<= 64 - i - minSymLen;
+                p += 2 * base64.size();
+
+                symLen.assign(readLE<uint16_t>(p), 0);
+                p += 2;
+                btree = p;
+                std::vector<bool> visited(symLen.size());
+                for (size_t sym = 0; sym < symLen.size(); sym++) {
+                    if (!visited[sym]) symLen[sym] = expandedLength(static_cast<int>(sym), visited);
+                }
+                return p + 3 * symLen.size() + (symLen.size() & 1);
+            }
+
+            [[nodiscard]] int decompress(uint64_t idx) const {
+                if (flags & FLAG_SingleValue) return minSymLen;
+
+                // start at the value the sparse index points to and walk to the block holding 'idx'
+                const uint64_t k = idx / span;
+                uint32_t block = readLE<uint32_t>(sparseIndex + 6 * k);
+                int64_t offset = readLE<uint16_t>(sparseIndex + 6 * k + 4) + static_cast<int64_t>(idx % span)
+                                 - static_cast<int64_t>(span / 2);
+                while (offset < 0) offset += length(--block) + 1;
+                while (offset > length(block)) offset -= length(block++) + 1;
+
+                // skip the symbols of the block until the one covering the offset
+                const uint8_t* ptr = data + static_cast<uint64_t>(block) * blockSize;
+                uint64_t buffer = readBE64(ptr);
+                ptr += 8;
+                int bits = 64;
+                int sym;
+                while (true) {
+                    size_t len = 0;
+                    while (buffer < base64[len]) len++;
+                    sym = static_cast<int>((buffer - base64[len]) >> (64 - len - minSymLen));
+                    sym += readLE<uint16_t>(lowestSym + 2 * len);
+                    if (offset < symLen[sym] + 1) break;
+
+                    offset -= symLen[sym] + 1;
+                    len += minSymLen;
+                    buffer <<= len;
+                    bits -= static_cast<int>(len);
+                    if (bits <= 32) {
+                        bits += 32;
+                        buffer |= static_cast<uint64_t>(readBE32(ptr)) << (64 - bits);
+                        ptr += 4;
+                    }
+                }
+
+                // expand the symbol down to the value at the offset
+                while (symLen[sym]) {
+                    const int l = left(sym);
+                    if (offset < symLen[l] + 1) {
+                        sym = l;
+                    } else {
+                        offset -= symLen[l] + 1;
+                        sym = right(sym);
+                    }
+                }
+                return left(sym);
+            }
+        };
+
+        /**
+         * The WDL and DTZ file of one material signature, white being the side listed first. WDL files hold a table
+         * per side to move unless the material is symmetric, DTZ files only one side. Tables with pawns have one per
+         * file of the leading pawn.
+         */
+        struct Table {
+            MaterialKey key{0}, key2{0};        // with white and with black as the side listed first
+            int pieceCount{0};
+            bool hasPawns{false}, hasUniquePieces{false};
+            int pawnCount[2]{};                 // the leading color first
+            std::unique_ptr<Utils::MappedFile> wdlFile, dtzFile;
+            PairsData wdl[2][4], dtz[4];
+            const uint8_t* dtzMap{nullptr};
+
+            [[nodiscard]] int sides() const { return key != key2 ? 2 : 1; }
+
+            template<bool isDTZ>
+            [[nodiscard]] const PairsData& pairs(int side, int file) const {
+                if constexpr (isDTZ) return dtz[file];
+                else return wdl[side % sides()][file];
+            }
+
+            template<bool isDTZ>
+            PairsData& pairs(int side, int file) {
+                return const_cast<PairsData&>(static_cast<const Table*>(this)->pairs<isDTZ>(side, file));
+            }
+        };
+
+        std::unique_ptr<Table> makeTable(std::string_view signature) {
+            auto table = std::make_unique<Table>();
+            table->key = Tablebases::materialKey(signature, true);
+            table->key2 = Tablebases::materialKey(signature, false);
+
+            auto count = [&](bool white, Piece_t piece) {
+                return static_cast<int>((table->key >> (4 * piece + (white ? 0 : 20))) & 0xF);
+            };
+            table->pieceCount = 2;
+            for (bool white: {true, false}) {
+                for (Piece_t piece = PIECE_Queen; piece <= PIECE_Pawn; piece++) {
+                    table->pieceCount += count(white, piece);
+                    table->hasUniquePieces |= count(white, piece) == 1;
+                }
+            }
+            const int whitePawns = count(true, PIECE_Pawn), blackPawns = count(false, PIECE_Pawn);
+            table->hasPawns = whitePawns || blackPawns;
+
+            // with pawns on both sides the side with fewer pawns leads
+            const bool whiteLeads = !blackPawns || (whitePawns && blackPawns >= whitePawns);
+            table->pawnCount[0] = whiteLeads ? whitePawns : blackPawns;
+            table->pawnCount[1] = whiteLeads ? blackPawns : whitePawns;
+            return table;
+        }
+
+        /**
+         * Splits the pieces into the groups that are encoded together and computes the index factor of every group.
+         * 'order' holds the position of the leading group and of the remaining pawns in the encoding.
+         */
+        void setGroups(const Table& table, PairsData& d, const int order[2], int file) {
+            int n = 0, firstLen = table.hasPawns ? 0 : table.hasUniquePieces ? 3 : 2;
+            d.groupLen[n] = 1;
+            for (int i = 1; i < table.pieceCount; i++) {
+                if (--firstLen > 0 || d.pieces[i] == d.pieces[i - 1]) d.groupLen[n]++;
+                else d.groupLen[++n] = 1;
+            }
+            d.groupLen[++n] = 0;
+
+            const bool bothPawns = table.hasPawns && table.pawnCount[1];
+            int next = bothPawns ? 2 : 1;
+            int freeSquares = 64 - d.groupLen[0] - (bothPawns ? d.groupLen[1] : 0);
+            uint64_t idx = 1;
+            for (int k = 0; next < n || k == order[0] || k == order[1]; k++) {
+                if (k == order[0]) {
+                    d.groupIdx[0] = idx;
+                    idx *= table.hasPawns ? ENCODING.leadPawnsSize[d.groupLen[0]][file]
+                                          : table.hasUniquePieces ? 31332 : 462;
+                } else if (k == order[1]) {
+                    d.groupIdx[1] = idx;
+                    idx *= ENCODING.binomial[d.groupLen[1]][48 - d.groupLen[0]];
+                } else {
+                    d.groupIdx[next] = idx;
+                    idx *= ENCODING.binomial[d.groupLen[next]][freeSquares];
+                    freeSquares -= d.groupLen[next++];
+                }
+            }
+            d.groupIdx[n] = idx;
+        }
+
+        /**
+         * Reads the layout of a mapped file into the tables. False if the magic is wrong or the file ends before
+         * the last block.
+         */
+        template<bool isDTZ>
+        bool parse(Table& table, const Utils::MappedFile& file) {
+            const std::string_view view = file.view();
+            const auto* base = reinterpret_cast<const uint8_t*>(view.data());
+            if (view.size() < 16 || std::memcmp(base, isDTZ ? DTZ_MAGIC : WDL_MAGIC, 4) != 0) return false;
+
+            const uint8_t* p = base + 4;
+            if (static_cast<bool>(*p++ & 2) != table.hasPawns) return false;
+
+            const int sides = isDTZ ? 1 : table.sides();
+            const int files = table.hasPawns ? 4 : 1;
+            const bool bothPawns = table.hasPawns && table.pawnCount[1];
+            for (int f = 0; f < files; f++) {
+                const int order[2][2] = {{p[0] & 0xF, bothPawns ? p[1] & 0xF : 0xF},
+                                         {p[0] >> 4, bothPawns ? p[1] >> 4 : 0xF}};
+                p += 1 + bothPawns;
+                for (int k = 0; k < table.pieceCount; k++, p++) {
+                    for (int side = 0; side < sides; side++) {
+                        table.pairs<isDTZ>(side, f).pieces[k] = side ? *p >> 4 : *p & 0xF;
+                    }
+                }
+                for (int side = 0; side < sides; side++) setGroups(table, table.pairs<isDTZ>(side, f), order[side], f);
+            }
+            p += (p - base) & 1;
+
+            for (int f = 0; f < files; f++) {
+                for (int side = 0; side < sides; side++) p = table.pairs<isDTZ>(side, f).setSizes(p);
+            }
+
+            if constexpr (isDTZ) {
+                table.dtzMap = p;
+                for (int f = 0; f < files; f++) {
+                    PairsData& d = table.dtz[f];
+                    if (!(d.flags & FLAG_Mapped)) continue;
+                    if (d.flags & FLAG_Wide) {
+                        p += (p - base) & 1;
+                        for (auto& idx: d.mapIdx) {
+                            idx = static_cast<uint16_t>((p - table.dtzMap) / 2 + 1);
+                            p += 2 * readLE<uint16_t>(p) + 2;
+                        }
+                    } else {
+                        for (auto& idx: d.mapIdx) {
+                            idx = static_cast<uint16_t>(p - table.dtzMap + 1);
+                            p += *p + 1;
+                        }
+                    }
+                }
+                p += (p - base) & 1;
+            }
+
+            for (int f = 0; f < files; f++) {
+                for (int side = 0; side < sides; side++) {
+                    PairsData& d = table.pairs<isDTZ>(side, f);
+                    d.sparseIndex = p;
+                    p += 6 * d.sparseIndexSize;
+                }
+            }
+            for (int f = 0; f < files; f++) {
+                for (int side = 0; side < sides; side++) {
+                    PairsData& d = table.pairs<isDTZ>(side, f);
+                    d.blockLength = p;
+                    p += 2 * d.blockLengthSize;
+                }
+            }
+            for (int f = 0; f < files; f++) {
+                for (int side = 0; side < sides; side++) {
+                    PairsData& d = table.pairs<isDTZ>(side, f);
+                    p = base + ((p - base + 63) & ~63);
+                    d.data = p;
+                    p += d.numBlocks * d.blockSize;
+                }
+            }
+            return static_cast<size_t>(p - base) <= view.size();
+        }
+
+        /// Where a position is stored: the table of a side and file and the index in it
+        struct Location {
+            int side{0}, file{0};
+            uint64_t index{0};
+        };
+
+        /**
+         * Encodes a position of the table's material. Positions with black as the side listed first, and with black
+         * to move in symmetric tables, are looked up with colors swapped and the board mirrored vertically.
+         */
+        template<bool isDTZ>
+        Location locate(const Table& table, const Board& board, bool whiteToMove) {
+            const bool flip = (table.key == table.key2 && !whiteToMove) || Tablebases::materialKey(board) != table.key;
+            const int flipColor = flip ? 8 : 0, flipSquares = flip ? 56 : 0;
+            Location location{flip ^ !whiteToMove, 0, 0};
+
+            int squares[MAX_PIECES]{}, pieces[MAX_PIECES]{};
+            int size = 0, leadPawnsCount = 0;
+            BB leadPawns{0};
+
+            // the leading pawn is the one nearest to the edge and among those the one on the lowest rank
+            auto pawnOrder = [](int a, int b) { return ENCODING.mapPawns[a] < ENCODING.mapPawns[b]; };
+            if (table.hasPawns) {
+                const bool leadWhite = !((table.pairs<isDTZ>(0, 0).pieces[0] ^ flipColor) & 8);
+                leadPawns = leadWhite ? board.wPawns : board.bPawns;
+                BB pawns = leadPawns;
+                Bitloop(pawns) squares[size++] = firstBitOf(pawns) ^ flipSquares;
+                leadPawnsCount = size;
+                std::swap(squares[0], *std::max_element(squares, squares + size, pawnOrder));
+                location.file = std::min(fileOf(squares[0]), 7 - fileOf(squares[0]));
+            }
+            const PairsData& d = table.pairs<isDTZ>(location.side, location.file);
+
+            const BB white = board.allPieces<true>();
+            BB rest = board.occ() & ~leadPawns;
+            Bitloop(rest) {
+                const int sq = firstBitOf(rest);
+                squares[size] = sq ^ flipSquares;
+                pieces[size++] = (PIECE_CODES[board.pieceAt(sq)] | (hasBitAt(white, sq) ? 0 : 8)) ^ flipColor;
+            }
+
+            // bring the pieces into the order of the table
+            for (int i = leadPawnsCount; i < size - 1; i++) {
+                for (int j = i; j < size; j++) {
+                    if (d.pieces[i] != pieces[j]) continue;
+                    std::swap(pieces[i], pieces[j]);
+                    std::swap(squares[i], squares[j]);
+                    break;
+                }
+            }
+
+            if (fileOf(squares[0]) > 3) {
+                for (int i = 0; i < size; i++) squares[i] ^= 7;
+            }
+
+            uint64_t idx;
+            if (table.hasPawns) {
+                idx = ENCODING.leadPawnIdx[leadPawnsCount][squares[0]];
+                std::stable_sort(squares + 1, squares + leadPawnsCount, pawnOrder);
+                for (int i = 1; i < leadPawnsCount; i++) idx += ENCODING.binomial[i][ENCODING.mapPawns[squares[i]]];
+            } else {
+                if (rankOf(squares[0]) > 3) {
+                    for (int i = 0; i < size; i++) squares[i] ^= 56;
+                }
+                // the first piece of the leading group off the a1-h8 diagonal goes below it
+                for (int i = 0; i < d.groupLen[0]; i++) {
+                    if (!offDiagonal(squares[i])) continue;
+                    if (offDiagonal(squares[i]) > 0) {
+                        for (int j = i; j < size; j++) squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+                    }
+                    break;
+                }
+
+                if (table.hasUniquePieces) {
+                    // three unique pieces, kings included, are encoded together
+                    const int adjust1 = squares[1] > squares[0];
+                    const int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+                    if (offDiagonal(squares[0])) {
+                        idx = (ENCODING.mapA1D1D4[squares[0]] * 63 + (squares[1] - adjust1)) * 62 + squares[2] - adjust2;
+                    } else if (offDiagonal(squares[1])) {
+                        idx = (6 * 63 + rankOf(squares[0]) * 28 + ENCODING.mapB1H1H7[squares[1]]) * 62
+                              + squares[2] - adjust2;
+                    } else if (offDiagonal(squares[2])) {
+                        idx = 6 * 63 * 62 + 4 * 28 * 62 + rankOf(squares[0]) * 7 * 28
+                              + (rankOf(squares[1]) - adjust1) * 28 + ENCODING.mapB1H1H7[squares[2]];
+                    } else {
+                        idx = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + rankOf(squares[0]) * 7 * 6
+                              + (rankOf(squares[1]) - adjust1) * 6 + rankOf(squares[2]) - adjust2;
+                    }
+                } else {
+                    idx = ENCODING.mapKK[ENCODING.mapA1D1D4[squares[0]]][squares[1]];
+                }
+            }
+            idx *= d.groupIdx[0];
+
+            // the remaining groups in ascending square order, skipping the squares of earlier groups
+            int* groupSq = squares + d.groupLen[0];
+            bool remainingPawns = table.hasPawns && table.pawnCount[1];
+            for (int next = 1; d.groupLen[next]; next++) {
+                std::stable_sort(groupSq, groupSq + d.groupLen[next]);
+                uint64_t n = 0;
+                for (int i = 0; i < d.groupLen[next]; i++) {
+                    const auto adjust = std::count_if(squares, groupSq, [&](int sq) { return groupSq[i] > sq; });
+                    n += ENCODING.binomial[i + 1][groupSq[i] - adjust - 8 * remainingPawns];
+                }
+                remainingPawns = false;
+                idx += n * d.groupIdx[next];
+                groupSq += d.groupLen[next];
+            }
+            location.index = idx;
+            return location;
+        }
+
+        struct Store {
+            std::vector<std::unique_ptr<Table>> owned;
+            std::unordered_map<MaterialKey, const Table*> tables;   // by both material keys of a table
+            std::vector<std::pair<std::string, Tablebases::ProbeFunction>> replaced;  // signature and earlier probe
+            int maxPieces{0};
+        };
+
+        Store& store() {
+            static Store instance;
+            return instance;
+        }
+
+        constexpr int sign(int value) { return (value > 0) - (value < 0); }
+
+        /// DTZ of a position whose best move zeroes the 50 move counter
+        constexpr int dtzBeforeZeroing(int wdl) {
+            switch (wdl) {
+                case SCORE_Win: return 1;
+                case SCORE_CursedWin: return 101;
+                case SCORE_BlessedLoss: return -101;
+                case SCORE_Loss: return -1;
+                default: return 0;
+            }
+        }
+
+        /// Converts a stored DTZ value to plies
+        int mapDTZ(const Table& table, const PairsData& d, int value, int wdl) {
+            static constexpr int MAP[5] = {1, 3, 0, 2, 0};   // value map of every wdl + 2
+            if (d.flags & FLAG_Mapped) {
+                const int ix = d.mapIdx[MAP[wdl + 2]] + value;
+                value = d.flags & FLAG_Wide ? readLE<uint16_t>(table.dtzMap + 2 * ix) : table.dtzMap[ix];
+            }
+            if ((wdl == SCORE_Win && !(d.flags & FLAG_WinPlies)) || (wdl == SCORE_Loss && !(d.flags & FLAG_LossPlies))
+                || wdl == SCORE_CursedWin || wdl == SCORE_BlessedLoss) {
+                value *= 2;
+            }
+            return value + 1;
+        }
+
+        /**
+         * Value stored for a position without looking at its moves, the WDL score or for DTZ tables the distance
+         * to zeroing in plies.
+         */
+        template<bool isDTZ>
+        int probeTable(const Board& board, bool whiteToMove, int wdl, ProbeState& state) {
+            const MaterialKey material = Tablebases::materialKey(board);
+            if (!isDTZ && material == 0) return SCORE_Draw;     // two bare kings
+
+            auto it = store().tables.find(material);
+            if (it == store().tables.end() || (isDTZ && !it->second->dtzFile)) {
+                state = PROBE_Fail;
+                return 0;
+            }
+            const Table& table = *it->second;
+            const Location location = locate<isDTZ>(table, board, whiteToMove);
+            const PairsData& d = table.pairs<isDTZ>(location.side, location.file);
+            if constexpr (isDTZ) {
+                if ((d.flags & FLAG_Stm) != location.side && !(table.key == table.key2 && !table.hasPawns)) {
+                    state = PROBE_ChangeSide;
+                    return 0;
+                }
+                return mapDTZ(table, d, d.decompress(location.index), wdl);
+            } else {
+                return d.decompress(location.index) - 2;
+            }
+        }
+
+        template<bool whiteToMove>
+        bool isMate(const Board& board) {
+            Board B{board};
+            MoveCollectors::MoveList list;
+            list.generate<whiteToMove>(B);
+            return list.count == 0 && list.pd.inCheck();
+        }
+
+        /**
+         * WDL score after resolving the captures, and with 'zeroingMoves' the pawn moves too. Tables may store any
+         * value for positions in which such a move is best, and never store en passant rights.
+         */
+        template<bool whiteToMove, bool zeroingMoves>
+        int search(const Board& board, ProbeState& state) {
+            Board B{board};
+            MoveCollectors::MoveList list;
+            list.generate<whiteToMove>(B);
+
+            int best = SCORE_Loss;
+            size_t searched = 0;
+            for (const Move& move: list) {
+                const bool capture = B.isCapture<whiteToMove>(move) || move.flags == MOVEFLAG_EnPassantCapture;
+                if (!capture && (!zeroingMoves || move.piece != PIECE_Pawn)) continue;
+                searched++;
+
+                const int value = -search<!whiteToMove, false>(B.fork<whiteToMove>(move), state);
+                if (state == PROBE_Fail) return SCORE_Draw;
+                if (value > best) {
+                    best = value;
+                    if (value >= SCORE_Win) {
+                        state = PROBE_ZeroingBest;
+                        return value;
+                    }
+                }
+            }
+
+            // with every move searched the stored value is not needed, it may be wrong with en passant rights
+            const bool allSearched = searched && searched == list.count;
+            int value = best;
+            if (!allSearched) {
+                value = probeTable<false>(board, whiteToMove, 0, state);
+                if (state == PROBE_Fail) return SCORE_Draw;
+            }
+            if (best >= value) {
+                state = best > SCORE_Draw || allSearched ? PROBE_ZeroingBest : PROBE_Ok;
+                return best;
+            }
+            state = PROBE_Ok;
+            return value;
+        }
+    }
+
+    /// WDL score of the side to move, 'state' is PROBE_Fail if a table is missing
+    template<bool whiteToMove>
+    int probeWDL(const Board& board, ProbeState& state) {
+        state = PROBE_Ok;
+        return detail::search<whiteToMove, false>(board, state);
+    }
+
+    /**
+     * Distance to zeroing the 50 move counter in plies, positive if the side to move wins and 0 for draws. Wins and
+     * losses the 50 move rule turns into draws are 100 plies further away. The value may be one ply too high if the
+     * table stores moves instead of plies.
+     */
+    template<bool whiteToMove>
+    int probeDTZ(const Board& board, ProbeState& state) {
+        using namespace detail;
+        state = PROBE_Ok;
+        const int wdl = search<whiteToMove, true>(board, state);
+        if (state == PROBE_Fail || wdl == SCORE_Draw) return 0;
+        if (state == PROBE_ZeroingBest) return dtzBeforeZeroing(wdl);
+
+        int dtz = probeTable<true>(board, whiteToMove, wdl, state);
+        if (state == PROBE_Fail) return 0;
+        if (state != PROBE_ChangeSide) {
+            return (dtz + 100 * (wdl == SCORE_BlessedLoss || wdl == SCORE_CursedWin)) * sign(wdl);
+        }
+
+        // the table stores the other side to move, take the best move by the DTZ after it
+        Board B{board};
+        MoveCollectors::MoveList list;
+        list.generate<whiteToMove>(B);
+        int minDTZ = 0xFFFF;
+        for (const Move& move: list) {
+            const Board next = B.fork<whiteToMove>(move);
+            const bool zeroing = next.halfmoveClock == 0;
+            // after a zeroing move only the sign of the result matters
+            dtz = zeroing ? -dtzBeforeZeroing(search<!whiteToMove, false>(next, state))
+                          : -probeDTZ<!whiteToMove>(next, state);
+            if (state == PROBE_Fail) return 0;
+            if (dtz == 1 && isMate<!whiteToMove>(next)) minDTZ = 1;
+            if (!zeroing) dtz += sign(dtz);
+            if (dtz < minDTZ && sign(dtz) == sign(wdl)) minDTZ = dtz;
+        }
+        // without legal moves the side to move is mated
+        return minDTZ == 0xFFFF ? -1 : minDTZ;
+    }
+
+    constexpr int MAX_DTZ = 1 << 16;
+
+    /**
+     * Ranks the root moves by their distance to zeroing, higher is better. Wins rank by how soon they zero the 50
+     * move counter, losses by how late. Wins and losses the 50 move rule turns into draws, given the counter of
+     * the root, rank between the real ones and draws.
+     *
+     * @return false if a WDL or DTZ table is missing, 'ranks' is incomplete then
+     */
+    template<bool whiteToMove>
+    bool rankRootMoves(const Board& board, const MoveCollectors::MoveList& list, std::vector<std::pair<Move, int>>& ranks) {
+        ProbeState state;
+        for (const Move& move: list) {
+            const Board next = board.fork<whiteToMove>(move);
+            int dtz;
+            if (next.halfmoveClock == 0) {
+                dtz = detail::dtzBeforeZeroing(-probeWDL<!whiteToMove>(next, state));
+            } else {
+                dtz = -probeDTZ<!whiteToMove>(next, state);
+                dtz += detail::sign(dtz);
+            }
+            if (state == PROBE_Fail) return false;
+            if (dtz == 2 && detail::isMate<!whiteToMove>(next)) dtz = 1;
+
+            const int plies = std::abs(dtz) + board.halfmoveClock;
+            int rank = 0;
+            if (dtz > 0) rank = plies <= 100 ? MAX_DTZ - dtz : MAX_DTZ / 2 - dtz;
+            else if (dtz < 0) rank = plies <= 100 ? -MAX_DTZ - dtz : -MAX_DTZ / 2 - dtz;
+            ranks.emplace_back(move, rank);
+        }
+        return true;
+    }
+
+    /**
+     * Probe function of the registry. Cursed wins and blessed losses count as draws, the 50 move counter of the
+     * position is not taken into account.
+     */
+    Tablebases::WDL probe(const Board& board, bool whiteToMove) {
+        ProbeState state;
+        const int wdl = whiteToMove ? probeWDL<true>(board, state) : probeWDL<false>(board, state);
+        if (state == PROBE_Fail) return Tablebases::WDL_Unknown;
+        return wdl == SCORE_Win ? Tablebases::WDL_Win : wdl == SCORE_Loss ? Tablebases::WDL_Loss : Tablebases::WDL_Draw;
+    }
+
+    /// Largest number of pieces, kings included, of the loaded tables
+    int maxPieces() {
+        return detail::store().maxPieces;
+    }
+
+    /**
+     * Loads the Syzygy tables (.rtbw, and .rtbz if present) of the directories in 'paths', separated by ':', and
+     * registers them with Tablebases. The files are memory-mapped. Tables of an earlier call are dropped and their
+     * material is answered by the table registered before them again, so init("") undoes loading. Like any
+     * registration this must not run during a search.
+     *
+     * @return the number of WDL tables found
+     */
+    size_t init(const std::string& paths) {
+        using namespace detail;
+        for (auto& [signature, previous]: store().replaced) Tablebases::unregisterTable(signature, probe, previous);
+        store() = {};
+
+        std::vector<std::filesystem::path> directories;
+        for (size_t start = 0, end; start <= paths.size(); start = end + 1) {
+            end = std::min(paths.find(':', start), paths.size());
+            if (end > start) directories.emplace_back(paths.substr(start, end - start));
+        }
+
+        size_t loaded = 0;
+        for (auto& directory: directories) {
+            std::error_code error;
+            for (auto& entry: std::filesystem::directory_iterator(directory, error)) {
+                if (entry.path().extension() != ".rtbw") continue;
+                const std::string signature = entry.path().stem().string();
+                const MaterialKey key = Tablebases::materialKey(signature);
+                if (!key || store().tables.contains(key)) continue;
+
+                auto table = makeTable(signature);
+                if (table->pieceCount > MAX_PIECES) continue;
+                table->wdlFile = std::make_unique<Utils::MappedFile>(entry.path().string(), MADV_RANDOM);
+                if (!parse<false>(*table, *table->wdlFile)) continue;
+
+                for (auto& dtzDirectory: directories) {
+                    const std::filesystem::path dtzPath = dtzDirectory / (signature + ".rtbz");
+                    if (!std::filesystem::exists(dtzPath, error)) continue;
+                    table->dtzFile = std::make_unique<Utils::MappedFile>(dtzPath.string(), MADV_RANDOM);
+                    if (!parse<true>(*table, *table->dtzFile)) table->dtzFile.reset();
+                    break;
+                }
+
+                store().maxPieces = std::max(store().maxPieces, table->pieceCount);
+                store().tables[table->key] = table.get();
+                store().tables[table->key2] = table.get();
+                store().owned.push_back(std::move(table));
+                store().replaced.emplace_back(signature, Tablebases::registerTable(signature, probe));
+                loaded++;
+            }
+        }
+        return loaded;
+    }
+
+} // namespace Dory::Syzygy
+
+#endif //DORY_SYZYGY_H
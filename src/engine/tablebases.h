@@ -0,0 +1,151 @@
+#ifndef DORY_TABLEBASES_H
+#define DORY_TABLEBASES_H
+
+#include <algorithm>
+#include <string_view>
+#include <unordered_map>
+
+#include "../core/board.h"
+
+namespace Dory::Tablebases {
+
+    /// Win / draw / loss from the view of the side to move
+    enum WDL : int8_t {
+        WDL_Loss = -1, WDL_Draw = 0, WDL_Win = 1, WDL_Unknown = 2
+    };
+
+    // tablebase wins rank below every mate score, but above any evaluation
+    const int TB_WIN = INF - 1000;
+
+    /// Score of a tablebase result 'ply' half moves from the root, nearer wins score higher
+    constexpr int score(WDL wdl, int ply) {
+        if (wdl == WDL_Win) return TB_WIN - ply;
+        if (wdl == WDL_Loss) return -(TB_WIN - ply);
+        return 0;
+    }
+
+    /**
+     * Counts of every piece type except kings, four bits per type, white in the low half.
+     */
+    using MaterialKey = uint64_t;
+
+    MaterialKey materialKey(const Board& board) {
+        const BB pieces[2][5] = {
+                {board.bQueens, board.bRooks, board.bBishops, board.bKnights, board.bPawns},
+                {board.wQueens, board.wRooks, board.wBishops, board.wKnights, board.wPawns}
+        };
+        MaterialKey key{0};
+        for (int white = 0; white < 2; white++) {
+            for (int piece = 0; piece < 5; piece++) {
+                key |= static_cast<MaterialKey>(bitCount(pieces[white][piece])) << (4 * piece + (white ? 0 : 20));
+            }
+        }
+        return key;
+    }
+
+    /**
+     * Key of a signature like "KRPvKR", the strong side first. Returns 0 for malformed signatures.
+     */
+    constexpr MaterialKey materialKey(std::string_view signature, bool strongSideWhite = true) {
+        MaterialKey key{0};
+        int side = 0;
+        for (char c: signature) {
+            const int shift = side == strongSideWhite ? 20 : 0;
+            switch (c) {
+                case 'K': break;
+                case 'Q': key += MaterialKey{1} << (shift + 4 * PIECE_Queen); break;
+                case 'R': key += MaterialKey{1} << (shift + 4 * PIECE_Rook); break;
+                case 'B': key += MaterialKey{1} << (shift + 4 * PIECE_Bishop); break;
+                case 'N': key += MaterialKey{1} << (shift + 4 * PIECE_Knight); break;
+                case 'P': key += MaterialKey{1} << (shift + 4 * PIECE_Pawn); break;
+                case 'v': side++; break;
+                default: return 0;
+            }
+        }
+        return side == 1 ? key : 0;
+    }
+
+    /// Probes a table for positions of its material, both colors must be handled
+    using ProbeFunction = WDL (*)(const Board& board, bool whiteToMove);
+
+    namespace detail {
+        WDL alwaysDraw(const Board&, bool) { return WDL_Draw; }
+
+        struct Registry {
+            std::unordered_map<MaterialKey, ProbeFunction> tables;
+            int maxPieces{0};
+
+            ProbeFunction add(std::string_view signature, ProbeFunction probe) {
+                auto it = tables.find(materialKey(signature, true));
+                const ProbeFunction previous = it == tables.end() ? nullptr : it->second;
+                tables[materialKey(signature, true)] = probe;
+                tables[materialKey(signature, false)] = probe;
+                int pieces = 0;
+                for (char c: signature) pieces += c != 'v';
+                maxPieces = std::max(maxPieces, pieces);
+                return previous;
+            }
+
+            void remove(std::string_view signature, ProbeFunction probe, ProbeFunction previous) {
+                for (MaterialKey key: {materialKey(signature, true), materialKey(signature, false)}) {
+                    auto it = tables.find(key);
+                    if (it == tables.end() || it->second != probe) continue;
+                    if (previous) it->second = previous;
+                    else tables.erase(it);
+                }
+                maxPieces = 0;
+                for (auto& [key, table]: tables) {
+                    int pieces = 2;
+                    for (int shift = 0; shift < 40; shift += 4) pieces += static_cast<int>((key >> shift) & 0xF);
+                    maxPieces = std::max(maxPieces, pieces);
+                }
+            }
+
+            Registry() {
+                // neither side can ever mate
+                for (std::string_view signature: {"KvK", "KNvK", "KBvK"}) add(signature, alwaysDraw);
+            }
+        };
+
+        Registry& registry() {
+            static Registry instance;
+            return instance;
+        }
+    }
+
+    /**
+     * Makes 'probe' answer for the material 'signature' and its color-swapped counterpart.
+     * Tables must be registered before searches start, probing does not lock.
+     *
+     * @return the probe function that answered for 'signature' before, nullptr if there was none
+     */
+    ProbeFunction registerTable(std::string_view signature, ProbeFunction probe) {
+        return detail::registry().add(signature, probe);
+    }
+
+    /**
+     * Undoes registerTable: 'signature' is answered by 'previous' again, or is unknown without it. Material that
+     * another table took over in between is left alone. Like registering this must not run during a search.
+     */
+    void unregisterTable(std::string_view signature, ProbeFunction probe, ProbeFunction previous = nullptr) {
+        detail::registry().remove(signature, probe, previous);
+    }
+
+    [[nodiscard]] bool hasTable(MaterialKey key) {
+        return detail::registry().tables.contains(key);
+    }
+
+    /// Largest number of pieces, kings included, of any registered table
+    int maxPieces() {
+        return detail::registry().maxPieces;
+    }
+
+    WDL probeWDL(const Board& board, bool whiteToMove) {
+        auto& tables = detail::registry().tables;
+        auto it = tables.find(materialKey(board));
+        return it == tables.end() ? WDL_Unknown : it->second(board, whiteToMove);
+    }
+
+} // namespace Dory::Tablebases
+
+#endif //DORY_TABLEBASES_H
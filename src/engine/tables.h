@@ -5,28 +5,41 @@
 #ifndef DORY_TABLES_H
 #define DORY_TABLES_H
 
+#include <algorithm>
+#include <array>
+#include <span>
 #include <unordered_map>
 #include <iostream>
 #include "../core/board.h"
 
 namespace Dory {
 
+    /**
+     * Entries hold the best move as a PackedMove, eight bytes per entry. They still live in an std::unordered_map,
+     * so every entry pays for a heap node on top of that, a fixed size bucket array is not part of this table.
+     */
     class TranspositionTable {
     public:
         struct TTEntry {
             int value;
-            Move move;
+            PackedMove move;
             int8_t depthDiff;
             uint8_t flag;
         };
+        static_assert(sizeof(TTEntry) == 8, "TTEntry should stay packed into eight bytes");
     private:
-        constexpr static const TTEntry NullEntry{0, NULLMOVE, 0, 0};
+        constexpr static const TTEntry NullEntry{0, NULLPACKEDMOVE, INT8_MIN, 0};
         std::unordered_map<uint64_t, TTEntry> lookup_table;
     public:
         static const uint8_t TTFlagExact = 0, TTFlagLowerBound = 1, TTFlagUpperBound = 2;
 //        unsigned long long lookups{0};
 
-        void insert(uint64_t boardHash, int eval, Move move, int depthDiff, int alpha, int beta) {
+        /// False for the entry returned by lookup() if the position is not stored
+        [[nodiscard]] static bool found(const TTEntry& entry) {
+            return entry.depthDiff != INT8_MIN;
+        }
+
+        void insert(uint64_t boardHash, int eval, PackedMove move, int depthDiff, int alpha, int beta) {
             uint8_t flag;
             if (eval <= alpha)
                 flag = TTFlagUpperBound;
@@ -72,37 +85,95 @@ namespace Dory {
 //        lookup_table.reserve(145000);
         }
 
+        /// Preallocates buckets for about 'mb' megabytes of entries, the table still grows beyond that if needed
+        void reserve(size_t mb) {
+            constexpr size_t bytesPerEntry = sizeof(std::pair<uint64_t, TTEntry>) + 2 * sizeof(void*);
+            lookup_table.reserve(mb * 1024 * 1024 / bytesPerEntry);
+        }
+
         size_t size() const { // in kB
             return lookup_table.size() * sizeof(TTEntry) / 1024;
         }
     };
 
+    /**
+     * Hashes of the positions before the current one in a fixed array, the game history before the search root at the
+     * bottom. Positions beyond the capacity are not stored and never reported as repetitions.
+     */
     class RepetitionTable {
-        std::vector<uint64_t> stack;
+    public:
+        // the halfmove clock saturates at 255, older positions can never be inside the window
+        static constexpr size_t MAX_GAME_HISTORY = 255;
+        static constexpr size_t CAPACITY = 1024;
+
+    private:
+        std::array<uint64_t, CAPACITY> stack{};
+        size_t size{0};
+        size_t gameLength{0};   // entries that were played before the search root
+
+#ifdef DORY_REPETITION_FILTER
+        // number of stored hashes per bucket, an empty bucket rules out a repetition without scanning the stack
+        static constexpr int FILTER_BITS = 10;
+        std::array<uint16_t, 1 << FILTER_BITS> filter{};
+
+        static constexpr size_t bucket(uint64_t boardHash) { return boardHash >> (64 - FILTER_BITS); }
+#endif
 
     public:
+        /// Positions of the game before the root, oldest first
+        void setGameHistory(std::span<const uint64_t> hashes) {
+            size = gameLength = 0;
+#ifdef DORY_REPETITION_FILTER
+            filter.fill(0);
+#endif
+            if (hashes.size() > MAX_GAME_HISTORY) hashes = hashes.last(MAX_GAME_HISTORY);
+            for (uint64_t h: hashes) push(h);
+            gameLength = size;
+        }
+
+        /// Removes the positions of the last search, the game history stays
         void reset() {
-            stack.clear();
+            while (size > gameLength) pop();
         }
 
         void push(uint64_t boardHash) {
-            stack.push_back(boardHash);
+            if (size < CAPACITY) {
+                stack[size] = boardHash;
+#ifdef DORY_REPETITION_FILTER
+                filter[bucket(boardHash)]++;
+#endif
+            }
+            size++;
         }
 
         void pop() {
-            if (!stack.empty())
-                stack.pop_back();
+            if (size <= gameLength) return;
+            size--;
+#ifdef DORY_REPETITION_FILTER
+            if (size < CAPACITY) filter[bucket(stack[size])]--;
+#endif
         }
 
-        /// Check for threefold repetition.
-        [[nodiscard]] bool check(uint64_t boardHash) const {
+#ifdef DORY_REPETITION_FILTER
+        /// Stored hashes that share the filter bucket of 'boardHash'
+        [[nodiscard]] size_t filterCount(uint64_t boardHash) const { return filter[bucket(boardHash)]; }
+#endif
+
+        /**
+         * A position repeats if it occurred since the last capture or pawn move ('halfmoveClock' plies), only
+         * positions with the same side to move at least four plies back are compared. Inside the search tree one
+         * earlier occurrence is enough to score a draw, positions of the game history must have occurred twice.
+         */
+        [[nodiscard]] bool check(uint64_t boardHash, int halfmoveClock) const {
+#ifdef DORY_REPETITION_FILTER
+            if (filter[bucket(boardHash)] == 0) return false;
+#endif
+            const size_t window = std::min<size_t>(halfmoveClock, size);
             int count = 0;
-            for (uint64_t h : stack) {
-                if (h == boardHash) {
-                    count++;
-                    if (count >= 2)
-                        return true; // second occurrence = repetition
-                }
+            for (size_t back = 4; back <= window; back += 2) {
+                const size_t ix = size - back;
+                if (ix < CAPACITY && stack[ix] == boardHash && (ix >= gameLength || ++count >= 2))
+                    return true;
             }
             return false;
         }
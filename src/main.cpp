@@ -1,6 +1,9 @@
+#include <fstream>
 #include <iostream>
+#include <optional>
 
 #include "dory.h"
+#include "utils/perfcounters.h"
 
 void printNodesPerSecond(unsigned long long nodes, double seconds) {
     nodes /= 1000;
@@ -44,14 +47,382 @@ void timePerft(Dory::Board& board, int depth, bool whiteToMove) {
     printNodesPerSecond(nodes, seconds.count());
 }
 
-int main() {
+template<Dory::PieceSteps::SliderImpl impl>
+void timeSliderLookups(const std::vector<Dory::BB>& occupancies) {
+    using namespace Dory::PieceSteps;
+    const int rounds = 16;
+    Dory::BB checksum{0};
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (Dory::BB occ: occupancies) {
+            for (int sq = 0; sq < 64; sq++) {
+                checksum += slideMask<true, impl>(occ, sq) + slideMask<false, impl>(occ, sq);
+            }
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double> seconds = end - start;
+    auto ms_int = duration_cast<std::chrono::milliseconds>(seconds);
+    unsigned long long lookups = 2ull * rounds * occupancies.size() * 64;
+
+    std::cout << lookups << " attack lookups in " << ms_int.count() << "ms  [checksum " << (checksum & 0xffff) << "]"
+              << "\t\t(" << (static_cast<double>(lookups) / 1000000) / seconds.count() << " M lookups/s)\n";
+}
+
+void benchSliders(Dory::Board& board, int depth, bool whiteToMove) {
+    using namespace Dory::PieceSteps;
+    const SliderImpl preferred = cpuHasFastPext() ? SliderImpl::Pext : SliderImpl::Magic;
+    std::cout << "CPU probe prefers " << sliderImplName(preferred) << ", search uses " << sliderImplName(sliderImpl)
+              << " slider attacks\n\n";
+
+    Dory::Utils::Random random;
+    std::vector<Dory::BB> occupancies(4096);
+    for (auto& occ: occupancies) occ = random.randomBitstring() & random.randomBitstring();
+
+    for (SliderImpl impl: {SliderImpl::Pext, SliderImpl::Magic}) {
+        std::cout << sliderImplName(impl) << ":\n";
+        if (impl == SliderImpl::Pext && !pextAvailable()) {
+            std::cout << "not supported on this CPU\n\n";
+            continue;
+        }
+
+        useSliderImpl(impl);
+        if (impl == SliderImpl::Pext) timeSliderLookups<SliderImpl::Pext>(occupancies);
+        else timeSliderLookups<SliderImpl::Magic>(occupancies);
+
+#ifdef DORY_SLIDER_DISPATCH
+        timePerft(board, depth, whiteToMove);
+#else
+        if (impl == sliderImpl) timePerft(board, depth, whiteToMove);
+#endif
+        std::cout << "\n";
+    }
+
+#ifdef DORY_SLIDER_DISPATCH
+    useSliderImpl(preferred);
+#endif
+}
+
+double timeMonteCarlo(Dory::MonteCarlo::GameTree& tree, size_t playouts, size_t threads) {
+    auto start = std::chrono::high_resolution_clock::now();
+    tree.search(playouts, threads);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double> seconds = end - start;
+    return seconds.count();
+}
+
+/**
+ * Runs the same number of playouts on 1, 2, 4, ... threads up to the number of cores and reports the speedup.
+ */
+void scaleMonteCarlo(Dory::Board& board, bool whiteToMove, size_t playouts) {
+    const size_t maxThreads = std::thread::hardware_concurrency();
+    std::vector<size_t> threadCounts;
+    for (size_t threads = 1; threads < maxThreads; threads *= 2) threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    double baseline = 0;
+    for (size_t threads: threadCounts) {
+        Dory::MonteCarlo::GameTree tree;
+        tree.setPosition(board, whiteToMove);
+        double seconds = timeMonteCarlo(tree, playouts, threads);
+        double rate = playouts / seconds;
+        if (threads == 1) baseline = rate;
+
+        std::cout << threads << " threads:\t" << static_cast<int>(rate) << " playouts/s\t\t(x" << rate / baseline
+                  << ")\tbest move " << Dory::Utils::moveNameShortNotation(tree.bestMove()) << "\n";
+    }
+}
+
+/**
+ * Formats one analysis result as a JSON object or CSV row. Scores are from the view of the side to move, mates are
+ * given in moves. The principal variation is given both in coordinate notation and in SAN.
+ */
+std::string formatAnalysis(size_t index, std::string_view fen, const Dory::Position& position,
+                           const Dory::Result& result, bool json) {
+    std::stringstream out;
+    std::string pv;
+    for (auto it = result.line.rbegin(); it != result.line.rend(); ++it) {
+        if (!pv.empty()) pv += ' ';
+        pv += Dory::Utils::moveFullNotation(*it);
+    }
+    std::string bestMove = result.line.empty() ? "" : Dory::Utils::moveFullNotation(result.line.back());
+    char san[512];
+    Dory::Utils::lineToSAN(position.first, position.second, result.line, san, sizeof(san));
+
+    std::string scoreType = "cp";
+    int score = result.eval;
+    if (Dory::Search::isMateEval(result.eval)) {
+        scoreType = "mate";
+        score = result.eval > 0 ? (Dory::INF - result.eval + 1) / 2 : -(Dory::INF + result.eval + 1) / 2;
+    }
+
+    if (json) {
+        out << R"({"index":)" << index << R"(,"fen":")" << fen << R"(",")" << scoreType << R"(":)" << score
+            << R"(,"bestmove":")" << bestMove << R"(","pv":")" << pv << R"(","san":")" << san << R"("})";
+    } else {
+        out << index << ",\"" << fen << "\"," << scoreType << "," << score << "," << bestMove << "," << pv << ","
+            << san;
+    }
+    return out.str();
+}
+
+/**
+ * Extracts the position of an EPD or FEN line, empty for blank lines and comments.
+ */
+std::string positionOfLine(std::string line) {
+    if (line.size() >= 3 && line.compare(0, 3, "\xEF\xBB\xBF") == 0) line.erase(0, 3);  // UTF-8 BOM
+    line = line.substr(0, line.find(';'));
+    while (!line.empty() && std::isspace(static_cast<unsigned char>(line.back()))) line.pop_back();
+    if (line.empty() || line[0] == '#') return "";
+    return line;
+}
+
+/**
+ * Splits a "key=value" option of a command, false if there is no '=' or either side is empty.
+ */
+bool splitOption(const std::string& option, std::string& key, std::string& value) {
+    const size_t eq = option.find('=');
+    if (eq == std::string::npos || eq == 0 || eq + 1 == option.size()) return false;
+    key = option.substr(0, eq);
+    value = option.substr(eq + 1);
+    return true;
+}
+
+const size_t STREAM_POSITIONS_PER_THREAD = 64;
+
+/**
+ * Analyzes every position of an EPD/FEN file and prints one result line per position in input order.
+ * The file is read in chunks, so memory stays bounded regardless of the input size.
+ */
+void analyzeStream(const std::string& path, Dory::SearchLimits limits, size_t threads, bool json) {
+    std::ifstream input(path);
+    if (!input.is_open()) {
+        std::cerr << "Could not open " << path << std::endl;
+        return;
+    }
+
+    Dory::Engine dory{};
+    const size_t chunkSize = STREAM_POSITIONS_PER_THREAD * threads;
+    std::vector<std::string> fens;
+    std::vector<Dory::Position> positions;
+    std::vector<std::optional<std::string>> pending;
+    size_t firstIndex = 0;
+
+    if (!json) std::cout << "index,fen,score_type,score,bestmove,pv,san\n";
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::string line;
+    bool more = true;
+    while (more) {
+        fens.clear();
+        positions.clear();
+        while (fens.size() < chunkSize && (more = static_cast<bool>(std::getline(input, line)))) {
+            std::string fen = positionOfLine(line);
+            if (fen.empty()) continue;
+            Dory::Position position;
+            if (auto error = Dory::Utils::parseFEN(fen, position.first, position.second)) {
+                std::cerr << "Skipping invalid position (" << error.message << "): " << fen << "\n";
+                continue;
+            }
+            positions.push_back(position);
+            fens.push_back(fen);
+        }
+        if (fens.empty()) break;
+
+        // results finish out of order, flush them as soon as all earlier ones are written
+        pending.assign(fens.size(), std::nullopt);
+        size_t nextToPrint = 0;
+        dory.analyzeBatch(std::span<const Dory::Position>{positions}, limits, threads,
+                          [&](size_t ix, const Dory::Result& result) {
+            pending[ix] = formatAnalysis(firstIndex + ix, fens[ix], positions[ix], result, json);
+            for (; nextToPrint < pending.size() && pending[nextToPrint]; nextToPrint++) {
+                std::cout << *pending[nextToPrint] << '\n';
+                pending[nextToPrint].reset();
+            }
+            std::cout.flush();
+        });
+        firstIndex += fens.size();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> seconds = end - start;
+
+    std::cerr << "Analyzed " << firstIndex << " positions in " << static_cast<int>(seconds.count() * 1000) << "ms\t\t("
+              << firstIndex / seconds.count() << " positions/s)" << std::endl;
+}
+
+/**
+ * Replays all games of a PGN file on 'threads' threads and reports how many games and positions it contains.
+ */
+void replayPGN(const std::string& path, size_t threads) {
+    Dory::Utils::MappedFile file{path};
+    if (!file.isOpen()) {
+        std::cerr << "Could not open " << path << std::endl;
+        return;
+    }
+
+    std::atomic<size_t> positions{0}, errors{0};
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t games = Dory::Utils::readPGNParallel(file.view(), threads, [&](const Dory::Utils::PGNGame& game, size_t) {
+        positions += game.moves.size() + 1;
+        if (game.error) errors++;
+    });
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> seconds = end - start;
+
+    std::cout << games << " games, " << positions << " positions, " << errors << " games with errors\n";
+    std::cout << "Read " << file.view().size() / 1024 << " kB on " << threads << " threads in "
+              << static_cast<int>(seconds.count() * 1000) << "ms\t\t(" << games / seconds.count() << " games/s, "
+              << positions / seconds.count() << " positions/s)" << std::endl;
+}
+
+/**
+ * Searches the built-in bench positions to a fixed depth. The node count is the signature of the search: it only
+ * changes with changes to the search, not with the machine or the number of threads.
+ */
+void runBench(int depth, size_t threads, size_t hashMb) {
+    DoryUtils::initialize();
+    Dory::Engine dory{};
+    dory.setHashSize(hashMb);
+    auto result = dory.bench(depth, threads);
+
+    std::cout << Dory::Utils::BENCH_POSITIONS.size() << " positions at depth " << depth << " on " << threads
+              << " threads with " << hashMb << " MB hash in " << static_cast<int>(result.seconds * 1000) << "ms\n";
+    std::cout << "Nodes searched: " << result.nodes << "\n";
+    std::cout << "Nodes/second: " << result.nodesPerSecond() << std::endl;
+}
+
+const int PROFILE_PERFT_DEPTH = 3;
+const int PROFILE_EVAL_ROUNDS = 20000;
+
+/**
+ * Measures perft, static evaluation and search over the bench positions with hardware performance counters, all on
+ * the calling thread. Needs a build with DORY_PERF_COUNTERS.
+ */
+void runProfile(int depth) {
+    using namespace Dory::Utils;
+    if constexpr (!PERF_COUNTERS) {
+        std::cerr << "Profiling needs a Linux build with -DDORY_PERF_COUNTERS=ON" << std::endl;
+        return;
+    }
+    DoryUtils::initialize();
+    PerfCounters counters;
+    if (!counters.available()) {
+        std::cerr << "perf_event_open failed, check /proc/sys/kernel/perf_event_paranoid" << std::endl;
+        return;
+    }
+
+    std::vector<Dory::Position> positions;
+    for (std::string_view fen: BENCH_POSITIONS) positions.push_back(parseFEN(fen));
+
+    uint64_t nodes{0};
+    counters.start();
+    for (auto [board, whiteToMove]: positions) {
+        nodes += DoryUtils::perftSingleDepth(board, whiteToMove, PROFILE_PERFT_DEPTH);
+    }
+    printPerfSample(std::cout, "perft", counters.stop(), nodes);
+
+    int checksum{0};
+    counters.start();
+    for (int r = 0; r < PROFILE_EVAL_ROUNDS; r++) {
+        for (auto& [board, whiteToMove]: positions) checksum += DoryUtils::staticEvaluation(board, whiteToMove);
+    }
+    PerfSample eval = counters.stop();
+    printPerfSample(std::cout, "eval", eval, static_cast<uint64_t>(PROFILE_EVAL_ROUNDS) * positions.size());
+
+    Dory::Engine dory{};
+    counters.start();
+    auto result = dory.bench(depth, 1);
+    printPerfSample(std::cout, "search", counters.stop(), result.nodes);
+    std::cout << "[eval checksum " << (checksum & 0xffff) << "]" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string_view{argv[1]} == "bench") {
+        // Dory bench [depth] [threads] [hash in MB]
+        int depth = argc > 2 ? std::atoi(argv[2]) : Dory::Utils::BENCH_DEFAULT_DEPTH;
+        size_t threads = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 1;
+        size_t hashMb = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 16;
+        runBench(depth > 0 ? depth : Dory::Utils::BENCH_DEFAULT_DEPTH, std::max<size_t>(threads, 1), hashMb);
+        return 0;
+    }
+    if (argc > 1 && std::string_view{argv[1]} == "profile") {
+        // Dory profile [search depth]
+        int depth = argc > 2 ? std::atoi(argv[2]) : Dory::Utils::BENCH_DEFAULT_DEPTH;
+        runProfile(depth > 0 ? depth : Dory::Utils::BENCH_DEFAULT_DEPTH);
+        return 0;
+    }
+
     std::string command, fen, depth_str, num_lines_str;
     std::getline(std::cin, command);
     std::getline(std::cin, fen);
     std::getline(std::cin, depth_str);
     int depth = static_cast<int>(std::strtol(depth_str.c_str(), nullptr, 10));
 
-    auto [board, whiteToMove] = DoryUtils::parseFEN(fen);
+    if(command == "analyze-stream") {
+        // the second line is the input file, an optional fourth line holds "nodes=<n> time=<ms> threads=<n> format=csv"
+        DoryUtils::initialize();
+        Dory::SearchLimits limits{depth > 0 ? depth : Dory::Search::MAX_ITER_DEPTH};
+        size_t threads = std::thread::hardware_concurrency();
+        bool json = true;
+
+        std::string options, option;
+        std::getline(std::cin, options);
+        std::stringstream optionStream(options);
+        while (optionStream >> option) {
+            std::string key, value;
+            size_t numThreads{0};
+            bool valid = splitOption(option, key, value);
+            if (valid) {
+                if (key == "nodes") valid = Dory::Utils::parseNumber(value, limits.nodes);
+                else if (key == "time") valid = Dory::Utils::parseNumber(value, limits.timeMs);
+                else if (key == "threads") valid = Dory::Utils::parseNumber(value, numThreads) && numThreads > 0;
+                else if (key == "format") valid = value == "csv" || value == "json";
+                else valid = false;
+            }
+
+            if (!valid) {
+                std::cerr << "Ignoring invalid option: " << option << "\n";
+                continue;
+            }
+            if (key == "threads") threads = numThreads;
+            if (key == "format") json = value == "json";
+        }
+
+        analyzeStream(fen, limits, threads, json);
+        return 0;
+    }
+    if(command == "book") {
+        // the second line is the PGN file, the third line the number of plies to include, the fourth the book file
+        DoryUtils::initialize();
+        std::string bookPath;
+        std::getline(std::cin, bookPath);
+        Dory::Utils::MappedFile file{fen};
+        if (!file.isOpen()) {
+            std::cerr << "Could not open " << fen << std::endl;
+            return 1;
+        }
+        size_t entries = Dory::Polyglot::writeBook(file.view(), bookPath, depth > 0 ? depth : 20);
+        std::cout << "Wrote " << entries << " book entries to " << bookPath << std::endl;
+        return 0;
+    }
+    if(command == "pgn") {
+        // the second line is the PGN file, the third line the number of threads (0 for all cores)
+        DoryUtils::initialize();
+        size_t threads = depth > 0 ? depth : std::thread::hardware_concurrency();
+        replayPGN(fen, threads);
+        return 0;
+    }
+
+    Dory::Board board;
+    bool whiteToMove{true};
+    if (fen == "startpos" || fen == "start") board = Dory::STARTBOARD;
+    else if (auto error = Dory::Utils::parseFEN(fen, board, whiteToMove)) {
+        std::cerr << "Invalid FEN at offset " << error.offset << " (" << error.message << "): " << fen << std::endl;
+        return 1;
+    }
 
     if(command == "perft") {
         DoryUtils::initialize();
@@ -63,6 +434,11 @@ int main() {
         DoryUtils::printDivide(board, whiteToMove, depth);
         return 0;
     }
+    if(command == "sliders") {
+        DoryUtils::initialize();
+        benchSliders(board, depth, whiteToMove);
+        return 0;
+    }
     if(command == "zobrist") {
         DoryUtils::initialize();
         size_t hash;
@@ -77,17 +453,116 @@ int main() {
         printf("Eval: %s\n", DoryUtils::parseEval(eval).c_str());
         return 0;
     }
-//    if(command == "montecarlo") {
-//        int res;
-//        Dory::initialize();
-//        if(whiteToMove) res = Dory::MonteCarlo::simulateGame<true>(board, depth);
-//        else res = Dory::MonteCarlo::simulateGame<false>(board, depth);
-//        std::cout << "Result: " << res << std::endl;
-//        return 0;
-//    }
+    if(command == "mcts") {
+        DoryUtils::initialize();
+        std::string threads_str;
+        std::getline(std::cin, threads_str);
+        size_t threads = std::strtoul(threads_str.c_str(), nullptr, 10);
+        if (threads == 0) threads = std::thread::hardware_concurrency();
+
+        Dory::MonteCarlo::GameTree tree;
+        tree.setPosition(board, whiteToMove);
+        double seconds = timeMonteCarlo(tree, depth, threads);
+
+        for (auto& [move, visits, score]: tree.rootStats()) {
+            std::cout << Dory::Utils::moveNameShortNotation(move) << "\t" << visits << "\t" << score << "\n";
+        }
+        std::cout << "\nBest move: " << Dory::Utils::moveNameShortNotation(tree.bestMove()) << "\n";
+        std::cout << depth << " playouts on " << threads << " threads in " << static_cast<int>(seconds * 1000) << "ms"
+                  << "\t\t(" << depth / seconds << " playouts/s)\n";
+        std::cout << "Tree size:\t" << tree.size() << " / " << tree.capacity() << " nodes" << std::endl;
+        return 0;
+    }
+    if(command == "playouts") {
+        DoryUtils::initialize();
+        std::string threads_str;
+        std::getline(std::cin, threads_str);
+        size_t threads = std::strtoul(threads_str.c_str(), nullptr, 10);
+        if (threads == 0) threads = std::thread::hardware_concurrency();
+
+        auto start = std::chrono::high_resolution_clock::now();
+        auto stats = Dory::MonteCarlo::playoutBatch(board, whiteToMove, depth, threads);
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> seconds = end - start;
+
+        std::cout << "+" << stats.wins << " =" << stats.draws << " -" << stats.losses << " for the side to move, "
+                  << static_cast<double>(stats.plies) / stats.games() << " plies per game\n";
+        std::cout << stats.games() << " playouts on " << threads << " threads in "
+                  << static_cast<int>(seconds.count() * 1000) << "ms\t\t(" << stats.games() / seconds.count()
+                  << " playouts/s)" << std::endl;
+        return 0;
+    }
+    if(command == "simulate") {
+        DoryUtils::initialize();
+        std::string games_str;
+        std::getline(std::cin, games_str);
+        size_t games = std::strtoul(games_str.c_str(), nullptr, 10);
+        size_t threads = std::thread::hardware_concurrency();
+
+        auto start = std::chrono::high_resolution_clock::now();
+        auto stats = Dory::MonteCarlo::runSimulations(board, whiteToMove, games, depth, threads);
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> seconds = end - start;
+
+        std::cout << "White " << stats.whiteWins << "  Draw " << stats.draws << "  Black " << stats.blackWins
+                  << "\t\t(white scores " << 100 * stats.whiteScore() << "%)\n";
+        std::cout << stats.games() << " games at depth " << depth << " on " << threads << " threads in "
+                  << static_cast<int>(seconds.count() * 1000) << "ms\t\t(" << stats.games() / seconds.count()
+                  << " games/s, " << static_cast<double>(stats.plies) / stats.games() << " plies per game)" << std::endl;
+        return 0;
+    }
+    if(command == "mcts-scaling") {
+        DoryUtils::initialize();
+        scaleMonteCarlo(board, whiteToMove, depth);
+        return 0;
+    }
+
+    if(command == "stats") {
+        // the statistics of every iteration are printed as JSON on the last line
+        Dory::Engine dory{};
+        dory.searchDepth(board, depth, whiteToMove);
+        std::cout << dory.searchStatsJSON() << std::endl;
+        return 0;
+    }
+
+    if(command == "trace") {
+        // the fourth line is the trace file, an optional fifth line holds "ply=<n> sample=<n> records=<n>"
+        std::string path, options, option;
+        std::getline(std::cin, path);
+        std::getline(std::cin, options);
+        Dory::Search::TraceOptions traceOptions{};
+        std::stringstream optionStream(options);
+        while (optionStream >> option) {
+            std::string key, value;
+            uint32_t sampleRate{0};
+            bool valid = splitOption(option, key, value);
+            if (valid) {
+                if (key == "ply") valid = Dory::Utils::parseNumber(value, traceOptions.maxPly);
+                else if (key == "sample") valid = Dory::Utils::parseNumber(value, sampleRate) && sampleRate > 0;
+                else if (key == "records") valid = Dory::Utils::parseNumber(value, traceOptions.maxRecords);
+                else valid = false;
+            }
+            if (!valid) std::cerr << "Ignoring invalid option: " << option << "\n";
+            else if (key == "sample") traceOptions.sampleRate = sampleRate;
+        }
+
+        Dory::Search::SearchTrace trace{traceOptions};
+        Dory::Engine dory{};
+        dory.setTrace(&trace);
+        dory.searchDepth(board, depth, whiteToMove);
+        if (!trace.save(path)) {
+            std::cerr << "Could not write " << path << std::endl;
+            return 1;
+        }
+        std::cout << "Wrote " << trace.records().size() << " records of " << dory.nodesSearched() << " nodes to "
+                  << path << std::endl;
+        return 0;
+    }
 
     Dory::Engine dory{};
 //    auto dory = std::make_unique<Dory::Dory>();
+    Dory::Search::ConsoleReporter console{std::cout};
+    dory.setReporter(console);
 
     timeEvaluation(dory, board, depth, whiteToMove);
 
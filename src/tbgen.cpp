@@ -0,0 +1,44 @@
+#include <iostream>
+
+#include "dory.h"
+
+/**
+ * Generates endgame bitbases by retrograde analysis.
+ *
+ * Every table the requested one can convert into (by captures or promotions) is generated first. All tables are
+ * written to '<dir>/<signature>.bb' and can be loaded by the engine with the UCI option BitbaseDir.
+ *
+ * Usage: ./tbgen <signature, e.g. KRvKP> [threads] [dir]
+ */
+int main(int argc, char* argv[]) {
+    size_t threads = std::thread::hardware_concurrency();
+    const bool validThreads = argc <= 2 || (Dory::Utils::parseNumber(std::string_view{argv[2]}, threads) && threads > 0);
+    if (argc < 2 || !validThreads) {
+        std::cerr << "Usage: " << argv[0] << " <signature> [threads] [dir]\n";
+        return 1;
+    }
+    const std::string signature = argv[1];
+    const std::string dir = argc > 3 ? argv[3] : ".";
+
+    const Dory::Tablebases::MaterialKey key = Dory::Tablebases::materialKey(signature);
+    if (key == 0 && signature != "KvK") {
+        std::cerr << "Invalid signature " << signature << "\n";
+        return 1;
+    }
+    if (Dory::Tablebases::hasTable(key)) {
+        std::cout << signature << " is a trivial draw\n";
+        return 0;
+    }
+
+    Timer timer;
+    timer.start();
+    Dory::Bitbases::generate(key, threads, [&](const Dory::Bitbases::Table& table) {
+        const std::string path = dir + "/" + table.name + ".bb";
+        if (!table.save(path)) {
+            std::cerr << "Could not write " << path << "\n";
+            return;
+        }
+        std::cout << table.name << "\t" << table.numEntries << " entries\t" << timer.timeMillis() << "ms\n";
+    });
+    return 0;
+}
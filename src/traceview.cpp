@@ -0,0 +1,123 @@
+#include <iomanip>
+#include <iostream>
+#include <map>
+
+#include "engine/searchtrace.h"
+#include "utils/utils.h"
+
+using namespace Dory;
+using namespace Dory::Search;
+
+std::string moveName(PackedMove move) {
+    static constexpr char promotions[] = "qrbn";
+    std::string name{static_cast<char>('a' + move.fromIndex() % 8), static_cast<char>('1' + move.fromIndex() / 8),
+                     static_cast<char>('a' + move.toIndex() % 8), static_cast<char>('1' + move.toIndex() / 8)};
+    if (move.flags() >= MOVEFLAG_PromoteQueen && move.flags() <= MOVEFLAG_PromoteKnight) {
+        name += promotions[move.flags() - MOVEFLAG_PromoteQueen];
+    }
+    return name;
+}
+
+std::string flagNames(uint8_t flags) {
+    std::string names;
+    if (flags & TRACE_Cutoff) names += 'C';
+    if (flags & TRACE_Research) names += 'R';
+    if (flags & TRACE_Interrupted) names += 'I';
+    return names.empty() ? "-" : names;
+}
+
+struct RootMoveEffort {
+    uint64_t nodes{0};
+    int searches{0};
+    int score{0};
+    uint8_t flags{0};
+};
+
+struct PlyEffort {
+    uint64_t records{0}, nodes{0};
+    uint64_t cutoffs{0}, firstMoveCutoffs{0}, cutoffIndexSum{0}, researches{0};
+};
+
+/**
+ * Summarizes a search trace written by the "trace" command of Dory: the nodes spent below every root move of one
+ * iteration, and per ply the subtree sizes, re-searches and how late in the move ordering the cutoffs happen.
+ * Aspiration re-searches of the root are added to the same root move.
+ *
+ * Usage: ./traceview <trace file> [iteration, default the last one]
+ */
+int main(int argc, char* argv[]) {
+    int iteration{0};
+    if (argc < 2 || (argc > 2 && !Utils::parseNumber(std::string_view{argv[2]}, iteration))) {
+        std::cerr << "Usage: " << argv[0] << " <trace file> [iteration]\n";
+        return 1;
+    }
+    SearchTrace trace;
+    if (!trace.load(argv[1])) {
+        std::cerr << "Could not read trace " << argv[1] << "\n";
+        return 1;
+    }
+    const auto& records = trace.records();
+    if (records.empty()) {
+        std::cout << "Empty trace\n";
+        return 0;
+    }
+
+    if (argc <= 2) {
+        for (const TraceRecord& r: records) iteration = std::max<int>(iteration, r.iteration);
+    }
+
+    std::vector<std::pair<PackedMove, RootMoveEffort>> rootMoves;
+    std::map<int, PlyEffort> plies;
+    uint64_t rootNodes{0};
+    for (const TraceRecord& r: records) {
+        if (r.iteration != iteration) continue;
+
+        PlyEffort& ply = plies[r.ply];
+        ply.records++;
+        ply.nodes += r.nodes;
+        ply.researches += (r.flags & TRACE_Research) != 0;
+        if (r.flags & TRACE_Cutoff) {
+            ply.cutoffs++;
+            ply.firstMoveCutoffs += r.moveIndex == 0;
+            ply.cutoffIndexSum += r.moveIndex;
+        }
+
+        if (r.ply != 0) continue;
+        auto it = std::find_if(rootMoves.begin(), rootMoves.end(), [&](auto& entry) { return entry.first == r.move; });
+        if (it == rootMoves.end()) it = rootMoves.insert(rootMoves.end(), {r.move, {}});
+        it->second.nodes += r.nodes;
+        it->second.searches++;
+        it->second.score = r.score;
+        it->second.flags |= r.flags;
+        rootNodes += r.nodes;
+    }
+
+    if (plies.empty()) {
+        std::cerr << "No records for iteration " << iteration << "\n";
+        return 1;
+    }
+    std::stable_sort(rootMoves.begin(), rootMoves.end(), [](auto& a, auto& b) { return a.second.nodes > b.second.nodes; });
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Iteration " << iteration << ", " << rootNodes << " nodes below the root, " << records.size()
+              << " records (ply <= " << trace.traceOptions().maxPly << ", 1 / " << trace.traceOptions().sampleRate
+              << " sampled)\n\n";
+
+    std::cout << "move\tnodes\t\tshare\tscore\t\tsearches\tflags\n";
+    for (auto& [move, effort]: rootMoves) {
+        std::cout << moveName(move) << '\t' << effort.nodes << "\t\t"
+                  << (rootNodes ? 100.0 * static_cast<double>(effort.nodes) / static_cast<double>(rootNodes) : 0)
+                  << "%\t" << effort.score << "\t\t" << effort.searches << "\t\t" << flagNames(effort.flags) << '\n';
+    }
+
+    std::cout << "\nply\trecords\tavg nodes\tcutoffs\tfirst move\tavg cutoff index\tre-searches\n";
+    for (auto& [ply, effort]: plies) {
+        const double cutoffs = static_cast<double>(std::max<uint64_t>(effort.cutoffs, 1));
+        std::cout << ply << '\t' << effort.records << '\t'
+                  << static_cast<double>(effort.nodes) / static_cast<double>(effort.records) << "\t\t"
+                  << effort.cutoffs << '\t' << 100.0 * static_cast<double>(effort.firstMoveCutoffs) / cutoffs << "%\t\t"
+                  << static_cast<double>(effort.cutoffIndexSum) / cutoffs << "\t\t\t" << effort.researches << '\n';
+    }
+    std::cout << "\nFlags: C beta cutoff, R re-searched after a null window fail high, I interrupted\n";
+    return 0;
+}
@@ -11,24 +11,86 @@ class UciManager {
     enum UciStatus{ IDLE = 0, NEW_GAME, READY, RUNNING };
     UciStatus status{IDLE};
 
+    Dory::Search::UciReporter reporter{std::cout};
+    Dory::Engine engine{};
     Dory::Board board;
     bool whiteToMove{true};
 
+    std::unique_ptr<Dory::Polyglot::Book> book;
+    bool ownBook{false}, bookBestMove{false};
+    Dory::Utils::WyRand rng;
+    Dory::Search::TablebaseOptions tbOptions{};
+    std::vector<uint64_t> history;
+
     void respond(std::string_view resp) {
         std::cout << resp << std::endl;
     }
 
+public:
+    UciManager() {
+        engine.setReporter(reporter);
+    }
+
+private:
     void processCommand(std::string_view cmd) {
-        if(cmd == "uci") respond("uciok");
-        else if(cmd == "ucinewgame") { Dory::initialize(); status = NEW_GAME; }
-        else if(cmd == "isready") respond("readyok");
+        if(cmd == "uci") {
+            respond("option name OwnBook type check default false");
+            respond("option name BookFile type string default <empty>");
+            respond("option name BookBestMove type check default false");
+            respond("option name TBProbeDepth type spin default 1 min 0 max 100");
+            respond("option name TBProbeLimit type spin default 32 min 0 max 32");
+            respond("option name BitbaseDir type string default <empty>");
+            respond("option name SyzygyPath type string default <empty>");
+            respond("uciok");
+        }
+        else if(cmd == "ucinewgame") { DoryUtils::initialize(); status = NEW_GAME; }
+        else if(cmd == "isready") {
+            // generating the KPK bitbase takes a moment, so it is done once the GUI waits for us anyway
+            Dory::Bitbases::initKPK();
+            respond("readyok");
+        }
 
         std::stringstream stream(cmd.data());
         std::string segment;
         std::vector<std::string> seglist;
         while(std::getline(stream, segment, ' ')) seglist.push_back(segment);
 
-        if(seglist.at(0) == "position") {
+        if(seglist.at(0) == "setoption" && seglist.size() >= 5) {
+            // setoption name <name> value <value>, the value may contain spaces
+            const std::string& name = seglist.at(2);
+            std::string value = seglist.at(4);
+            for(size_t ix = 5; ix < seglist.size(); ix++) value += ' ' + seglist.at(ix);
+            if(value == "<empty>") value.clear();
+
+            if(name == "OwnBook") ownBook = value == "true";
+            else if(name == "BookBestMove") bookBestMove = value == "true";
+            else if(name == "TBProbeDepth" || name == "TBProbeLimit") {
+                const int max = name == "TBProbeDepth" ? 100 : 32;
+                int parsed;
+                if(!Dory::Utils::parseNumber(value, parsed) || parsed > max)
+                    respond("info string invalid value " + value + " for " + name);
+                else {
+                    (name == "TBProbeDepth" ? tbOptions.probeDepth : tbOptions.probeLimit) = parsed;
+                    engine.setTablebaseOptions(tbOptions);
+                }
+            }
+            else if(name == "BitbaseDir") {
+                size_t loaded = value.empty() ? 0 : Dory::Bitbases::loadDirectory(value);
+                respond("info string loaded " + std::to_string(loaded) + " bitbases from " + value);
+            }
+            else if(name == "SyzygyPath") {
+                size_t found = Dory::Syzygy::init(value);
+                respond("info string found " + std::to_string(found) + " tablebases in " + value);
+            }
+            else if(name == "BookFile") {
+                if(value.empty()) book.reset();
+                else {
+                    book = std::make_unique<Dory::Polyglot::Book>(value);
+                    if(!book->isOpen()) respond("info string could not open book " + value);
+                }
+            }
+        }
+        else if(seglist.at(0) == "position") {
             if(seglist.at(1) == "startpos") { board = Dory::STARTBOARD; whiteToMove = true; }
             else {
                 auto [b, w] = Dory::Utils::parseFEN(seglist, 2);
@@ -40,17 +102,28 @@ class UciManager {
             while(ix < seglist.size() && seglist.at(ix) != "moves") ix++;
             ix++;
 
+            history.clear();
             while(ix < seglist.size()) {
+                history.push_back(Dory::Zobrist::hash(board, whiteToMove));
                 Dory::Move move = Dory::Utils::parseMove(board, whiteToMove, seglist.at(ix));
                 board.makeMove(move, whiteToMove);
                 whiteToMove = !whiteToMove;
                 ++ix;
             }
+            engine.setGameHistory(history);
             status = READY;
         }
         else if (seglist.at(0) == "go") {
             status = RUNNING;
-            auto [eval, line] = Dory::searchDepth(board, 6, whiteToMove);
+            if(ownBook && book) {
+                Dory::Move move = book->pick(board, whiteToMove, bookBestMove, rng);
+                if(move != Dory::NULLMOVE) {
+                    std::cout << "bestmove " << Dory::Utils::moveFullNotation(move) << std::endl;
+                    status = READY;
+                    return;
+                }
+            }
+            auto [eval, line] = engine.searchDepth(board, 6, whiteToMove);
             std::cout << "bestmove " << Dory::Utils::moveFullNotation(line.back()) << std::endl;
             status = READY;
         }
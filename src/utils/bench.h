@@ -0,0 +1,59 @@
+#ifndef DORY_BENCH_H
+#define DORY_BENCH_H
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace Dory::Utils {
+
+    const int BENCH_DEFAULT_DEPTH = 5;
+
+    /// Opening and middlegame positions of resources/equalPositions.txt and the perft test positions
+    constexpr std::array<std::string_view, 32> BENCH_POSITIONS = {
+            "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+            "rnb2rk1/p3qpb1/1pp2npp/4p3/1PB1P3/P1N1BN2/2P2PPP/R2QR1K1 w - - 0 12",
+            "r1bqk2r/pp1nbpp1/4p2p/3p4/2pP4/2PBPNP1/PP1N1PP1/R2QK2R w KQkq - 0 11",
+            "2kr3r/ppq2pp1/2pb1n1p/4p3/2P5/2N1PB1P/PP3PP1/R2Q1RK1 w - - 1 14",
+            "r4rk1/1ppq1ppp/p1np1n2/2b5/4P1b1/2NB1N2/PPP2PPP/R1BQR1K1 w - - 4 12",
+            "r2q1rk1/pp1nbppp/2p1p1b1/3pP3/1P1P4/P1NPBN1P/3Q1PP1/R4RK1 w - - 1 15",
+            "r2q1rk1/pp2b1pp/2nppn2/2p5/4P3/4BN2/PPPN1PPP/R2Q1RK1 w - - 0 11",
+            "r2q1rk1/pb2bppp/1pn2n2/2pp4/3P4/1P2PN2/PB1NBPPP/R2Q1RK1 w - - 0 11",
+            "r1bqk2r/pp1nbppp/2p2n2/P2p4/3Pp3/1N2P3/1PP1BPPP/RNBQ1RK1 w kq - 1 10",
+            "r4rk1/1ppq1pbp/2np1np1/p3p3/4P1b1/1P1P1NP1/PBPN1PBP/R2QR1K1 w - - 0 11",
+            "r1bqr1k1/p1p2ppp/2pp4/8/4n3/2P2N1P/PPP2PP1/R1BQ1RK1 w - - 0 11",
+            "r2q1rk1/pp1bbppp/2n1pn2/2pp4/3P4/2PBPN2/PP3PPP/RNBQR1K1 w - - 8 9",
+            "r2q1rk1/1b3ppp/2np1b2/p3p3/1pP1P3/3BN3/PP3PPP/R1BQ1RK1 w - - 0 15",
+            "r2q1rk1/pp1bp1b1/2pp1npp/5p2/1PPP4/P1N1PN1P/5PP1/1R1QKB1R w K - 3 12",
+            "rnbq1rk1/1pp1bppp/5n2/p7/1P2p3/P3P3/1BPNNPPP/R2QKB1R w KQ - 0 9",
+            "r4rk1/pb1q2pp/1pnb1n2/5pB1/3p4/3P1N2/PP1N1PPP/R2QRBK1 w - - 2 15",
+            "r3k1nr/1bqpbpp1/p1n1p3/1pp4p/4P2P/2NP2P1/PPP1NPB1/R1B1QRK1 w kq - 1 10",
+            "r3k2r/1bq2pbp/p3pnp1/1pp1p3/4P3/2PP1P2/PP2BNPP/R1BQ1RK1 w kq - 1 14",
+            "r1bq1rk1/pp2ppbp/1nnp2p1/8/3P4/2PB1N2/PP1N1PPP/R1BQ1RK1 w - - 3 10",
+            "r1bqk2r/3nppbp/p2p1np1/1p6/3NP3/1P1B4/PBP2PPP/RN1QR1K1 w kq - 0 10",
+            "r1br1nk1/pp2q1p1/2p1p2p/3p1p2/2PP1P2/1PN1P3/P5PP/1BRQ1RK1 w - - 0 18",
+            "2rqr1k1/1b1n1ppp/pp1Bpn2/3p4/2PP4/1P3NP1/P4PBP/R2Q1RK1 w - - 1 15",
+            "r3k2r/pbpnqpb1/1p1ppnpp/8/3P1BPP/2P1PN2/PP1N1P2/R2QKBR1 w Qkq - 0 11",
+            "r2r4/1b3pkp/2p2np1/p1n1p3/1p2P1P1/5P1P/PPPRBN2/2K3NR w - - 4 18",
+            "2kr3r/pp2p2p/3p1np1/q1pPnp2/b1P2N2/2P1PP2/P2BB1PP/RQ3RK1 w - - 10 14",
+            "r1bq1rk1/pp1nbpp1/2p2n1p/3p4/3P3B/2NBPN2/PP3PPP/R2QK2R w KQ - 0 10",
+            "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+            "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+            "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+            "r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1",
+            "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+            "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10"
+    };
+
+    struct BenchResult {
+        uint64_t nodes{0};      // the signature, identical for every build with the same search
+        double seconds{0};
+
+        [[nodiscard]] uint64_t nodesPerSecond() const {
+            return seconds > 0 ? static_cast<uint64_t>(static_cast<double>(nodes) / seconds) : 0;
+        }
+    };
+
+} // namespace Dory::Utils
+
+#endif //DORY_BENCH_H
@@ -5,98 +5,226 @@
 #ifndef DORY_FENREADER_H
 #define DORY_FENREADER_H
 
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
 #include <vector>
 #include "../core/board.h"
 #include "../utils/utils.h"
 
 namespace Dory::Utils {
 
-    std::pair<Board, bool> parseFEN(std::vector<std::string>& fenParts, int ix) {
+    /**
+     * Describes why a FEN string could not be parsed. 'offset' is the index of the offending character.
+     */
+    struct FENError {
+        const char* message{nullptr};
+        size_t offset{0};
+
+        explicit operator bool() const { return message != nullptr; }
+    };
+
+    // Longest possible FEN including the move counters and a terminating zero
+    constexpr size_t MAX_FEN_LENGTH = 100;
+
+    /**
+     * Parses a FEN string in a single pass without allocating. Only piece placement, side to move, castling rights
+     * and en passant square are required. The halfmove clock is stored in the board if present, the fullmove number
+     * in 'fullmoveNumber', which is 0 if the field is missing.
+     * 'board', 'whiteToMove' and 'fullmoveNumber' are only written on success.
+     */
+    FENError parseFEN(std::string_view fen, Board& board, bool& whiteToMove, unsigned& fullmoveNumber) {
+        BB pieces[2][6]{};
+        int kings[2]{-1, -1};
+        size_t ix = 0;
+
+        auto error = [&ix](const char* message) { return FENError{message, ix}; };
+        auto skipSpaces = [&]() {
+            size_t start = ix;
+            while (ix < fen.size() && fen[ix] == ' ') ix++;
+            return ix > start;
+        };
+
+        /// 1. Piece placement
+        int rank = 7, file = 0;
+        for (; ix < fen.size() && fen[ix] != ' '; ix++) {
+            const char c = fen[ix];
+            if (c == '/') {
+                if (file != 8) return error("rank does not have 8 files");
+                if (--rank < 0) return error("too many ranks");
+                file = 0;
+                continue;
+            }
+            if (c >= '0' && c <= '9') {
+                if (c == '0') return error("invalid number of empty squares");
+                file += c - '0';
+                if (file > 8) return error("rank does not have 8 files");
+                continue;
+            }
 
-        std::string position = fenParts.at(ix), currentPlayer = fenParts.at(ix+1), castling = fenParts.at(ix+2), ep = fenParts.at(ix+3);
-
-        int rank{7}, file{0};
-
-        BB wPawns{0}, bPawns{0}, wKnights{0}, bKnights{0}, wBishops{0}, bBishops{0}, wRooks{0}, bRooks{0}, wQueens{0}, bQueens{0};
-        uint8_t wKing{0}, bKing{1};
-        for (char c: position) {
-            switch (c) {
-                case 'P':
-                    setBit(wPawns, 8 * rank + file);
-                    break;
-                case 'N':
-                    setBit(wKnights, 8 * rank + file);
-                    break;
-                case 'B':
-                    setBit(wBishops, 8 * rank + file);
-                    break;
-                case 'R':
-                    setBit(wRooks, 8 * rank + file);
-                    break;
-                case 'Q':
-                    setBit(wQueens, 8 * rank + file);
-                    break;
-                case 'K':
-                    wKing = 8 * rank + file;
-                    break;
-                case 'p':
-                    setBit(bPawns, 8 * rank + file);
-                    break;
-                case 'n':
-                    setBit(bKnights, 8 * rank + file);
-                    break;
-                case 'b':
-                    setBit(bBishops, 8 * rank + file);
-                    break;
-                case 'r':
-                    setBit(bRooks, 8 * rank + file);
-                    break;
-                case 'q':
-                    setBit(bQueens, 8 * rank + file);
-                    break;
-                case 'k':
-                    bKing = 8 * rank + file;
-                    break;
-                case '/':
-                    rank--;
-                    file = 0;
-                    continue;
-                default:
-                    if (isdigit(c)) file += c - '1';
-                    break;
+            const bool white = c >= 'A' && c <= 'Z';
+            Piece_t piece;
+            switch (white ? c - 'A' + 'a' : c) {
+                case 'p': piece = PIECE_Pawn; break;
+                case 'n': piece = PIECE_Knight; break;
+                case 'b': piece = PIECE_Bishop; break;
+                case 'r': piece = PIECE_Rook; break;
+                case 'q': piece = PIECE_Queen; break;
+                case 'k': piece = PIECE_King; break;
+                default: return error("unknown piece");
             }
+            if (file > 7) return error("rank does not have 8 files");
 
-            file++;
+            const int sq = 8 * rank + file++;
+            if (piece == PIECE_King) {
+                if (kings[white] >= 0) return error("more than one king of a color");
+                kings[white] = sq;
+            } else pieces[white][piece] |= newMask(sq);
         }
+        if (rank != 0 || file != 8) return error("board does not have 8 ranks of 8 files");
+        if (kings[0] < 0 || kings[1] < 0) return error("missing king");
 
-        uint8_t enPassantField{0};
-        if(ep != "-") enPassantField = sqId(ep);
+        /// 2. Side to move
+        if (!skipSpaces() || ix >= fen.size()) return error("missing side to move");
+        if (fen[ix] != 'w' && fen[ix] != 'b') return error("side to move must be 'w' or 'b'");
+        const bool white = fen[ix++] == 'w';
 
-        // second position is side to move
-        const bool w = fenParts.at(ix+1) == "w";
+        /// 3. Castling rights
+        if (!skipSpaces() || ix >= fen.size()) return error("missing castling rights");
+        uint8_t castlingRights{0};
+        if (fen[ix] == '-') ix++;
+        else for (; ix < fen.size() && fen[ix] != ' '; ix++) {
+            switch (fen[ix]) {
+                case 'K': castlingRights |= wCastleShortMask; break;
+                case 'Q': castlingRights |= wCastleLongMask; break;
+                case 'k': castlingRights |= bCastleShortMask; break;
+                case 'q': castlingRights |= bCastleLongMask; break;
+                default: return error("invalid castling rights");
+            }
+        }
 
-        // castling rights
-        const bool wcs = fenParts.at(ix+2).find('K') != std::string::npos;
-        const bool wcl = fenParts.at(ix+2).find('Q') != std::string::npos;
-        const bool bcs = fenParts.at(ix+2).find('k') != std::string::npos;
-        const bool bcl = fenParts.at(ix+2).find('q') != std::string::npos;
+        /// 4. En passant square
+        if (!skipSpaces() || ix >= fen.size()) return error("missing en passant square");
+        uint8_t enPassantField{0};
+        if (fen[ix] == '-') ix++;
+        else {
+            if (ix + 1 >= fen.size() || fen[ix] < 'a' || fen[ix] > 'h' || fen[ix + 1] != (white ? '6' : '3')) {
+                return error("invalid en passant square");
+            }
+            enPassantField = 8 * (fen[ix + 1] - '1') + (fen[ix] - 'a');
+            ix += 2;
+        }
 
-        uint8_t castlingRights{0};
-        if(wcs) castlingRights |= wCastleShortMask;
-        if(wcl) castlingRights |= wCastleLongMask;
-        if(bcs) castlingRights |= bCastleShortMask;
-        if(bcl) castlingRights |= bCastleLongMask;
+        /// 5. Optional move counters
+        unsigned counters[2]{0, 0};
+        for (int counter = 0; counter < 2 && skipSpaces() && ix < fen.size(); counter++) {
+            if (fen[ix] < '0' || fen[ix] > '9') return error("move counter is not a number");
+            for (; ix < fen.size() && fen[ix] >= '0' && fen[ix] <= '9'; ix++) {
+                counters[counter] = std::min(10 * counters[counter] + (fen[ix] - '0'), counter ? 99999u : 255u);
+            }
+        }
+        if (ix < fen.size() && fen[ix] != ' ') return error("unexpected character");
+
+        board = Board{
+            pieces[1][PIECE_Pawn], pieces[0][PIECE_Pawn], pieces[1][PIECE_Knight], pieces[0][PIECE_Knight],
+            pieces[1][PIECE_Bishop], pieces[0][PIECE_Bishop], pieces[1][PIECE_Rook], pieces[0][PIECE_Rook],
+            pieces[1][PIECE_Queen], pieces[0][PIECE_Queen], static_cast<uint8_t>(kings[1]),
+            static_cast<uint8_t>(kings[0]), enPassantField, castlingRights, static_cast<uint8_t>(counters[0])
+        };
+        whiteToMove = white;
+        fullmoveNumber = counters[1];
+        return {};
+    }
 
-        return {{ wPawns, bPawns, wKnights, bKnights, wBishops, bBishops, wRooks, bRooks, wQueens, bQueens, wKing, bKing, enPassantField, castlingRights }, w};
+    FENError parseFEN(std::string_view fen, Board& board, bool& whiteToMove) {
+        unsigned fullmoveNumber;
+        return parseFEN(fen, board, whiteToMove, fullmoveNumber);
     }
 
+    /**
+     * Parses a FEN string or "startpos". Throws std::invalid_argument for malformed input.
+     */
     std::pair<Board, bool> parseFEN(const std::string_view& fen) {
         if(fen == "startpos" || fen == "start") return {STARTBOARD, true};
-        std::stringstream stream(fen.data());
-        std::string segment;
-        std::vector<std::string> seglist;
-        while(std::getline(stream, segment, ' ')) seglist.push_back(segment);
-        return parseFEN(seglist, 0);
+        std::pair<Board, bool> result{STARTBOARD, true};
+        if (FENError err = parseFEN(fen, result.first, result.second)) {
+            throw std::invalid_argument(std::string{"Invalid FEN at offset "} + std::to_string(err.offset) + ": "
+                                        + err.message + " (" + std::string{fen} + ")");
+        }
+        return result;
+    }
+
+    std::pair<Board, bool> parseFEN(std::vector<std::string>& fenParts, int ix) {
+        std::string fen = fenParts.at(ix) + ' ' + fenParts.at(ix+1) + ' ' + fenParts.at(ix+2) + ' ' + fenParts.at(ix+3);
+        // the move counters are optional, a "moves" list may follow right away
+        for (size_t i = ix + 4; i < fenParts.size() && i < static_cast<size_t>(ix) + 6 && fenParts[i] != "moves"; i++) {
+            fen += ' ' + fenParts[i];
+        }
+        return parseFEN(std::string_view{fen});
+    }
+
+    /**
+     * Writes the FEN of the position into 'buffer', which must hold at least MAX_FEN_LENGTH characters.
+     * The board does not know the fullmove number, the field is left out unless 'fullmoveNumber' is given.
+     *
+     * @return the length of the FEN, excluding the terminating zero
+     */
+    size_t toFEN(const Board& board, bool whiteToMove, char* buffer, unsigned fullmoveNumber = 0) {
+        static constexpr char pieceChars[2][7] = {{'q', 'r', 'b', 'n', 'p', 'k', ' '},
+                                                  {'Q', 'R', 'B', 'N', 'P', 'K', ' '}};
+        const BB whitePieces = board.allPieces<true>();
+        char* out = buffer;
+
+        for (int rank = 7; rank >= 0; rank--) {
+            int empty = 0;
+            for (int file = 0; file < 8; file++) {
+                const int sq = 8 * rank + file;
+                const Piece_t piece = board.pieceAt(sq);
+                if (piece == PIECE_None) {
+                    empty++;
+                    continue;
+                }
+                if (empty) *out++ = static_cast<char>('0' + empty);
+                empty = 0;
+                *out++ = pieceChars[hasBitAt(whitePieces, sq)][piece];
+            }
+            if (empty) *out++ = static_cast<char>('0' + empty);
+            if (rank) *out++ = '/';
+        }
+
+        *out++ = ' ';
+        *out++ = whiteToMove ? 'w' : 'b';
+        *out++ = ' ';
+
+        const uint8_t castling = board.castlingRights();
+        if (castling & wCastleShortMask) *out++ = 'K';
+        if (castling & wCastleLongMask) *out++ = 'Q';
+        if (castling & bCastleShortMask) *out++ = 'k';
+        if (castling & bCastleLongMask) *out++ = 'q';
+        if (!castling) *out++ = '-';
+
+        *out++ = ' ';
+        if (board.hasEnPassant()) {
+            *out++ = static_cast<char>('a' + fileOf(board.enPassantSq));
+            *out++ = static_cast<char>('1' + rankOf(board.enPassantSq));
+        } else *out++ = '-';
+
+        *out++ = ' ';
+        if (board.halfmoveClock >= 100) *out++ = static_cast<char>('0' + board.halfmoveClock / 100);
+        if (board.halfmoveClock >= 10) *out++ = static_cast<char>('0' + board.halfmoveClock / 10 % 10);
+        *out++ = static_cast<char>('0' + board.halfmoveClock % 10);
+        if (fullmoveNumber) {
+            *out++ = ' ';
+            out = std::to_chars(out, buffer + MAX_FEN_LENGTH, fullmoveNumber).ptr;
+        }
+        *out = '\0';
+        return out - buffer;
+    }
+
+    std::string toFEN(const Board& board, bool whiteToMove, unsigned fullmoveNumber = 0) {
+        char buffer[MAX_FEN_LENGTH];
+        size_t length = toFEN(board, whiteToMove, buffer, fullmoveNumber);
+        return {buffer, length};
     }
 
 } // namespace Dory::Utils
@@ -0,0 +1,143 @@
+#ifndef DORY_PERFCOUNTERS_H
+#define DORY_PERFCOUNTERS_H
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+
+#if defined(DORY_PERF_COUNTERS) && defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Dory::Utils {
+
+#if defined(DORY_PERF_COUNTERS) && defined(__linux__)
+    constexpr bool PERF_COUNTERS = true;
+#else
+    constexpr bool PERF_COUNTERS = false;
+#endif
+
+    enum PerfEvent : uint8_t {
+        PERF_Cycles, PERF_Instructions, PERF_BranchMisses, PERF_L1DMisses, PERF_LLCMisses, PERF_EventCount
+    };
+
+    constexpr std::array<std::string_view, PERF_EventCount> PERF_EVENT_NAMES = {
+            "cycles", "instructions", "branchMisses", "l1dMisses", "llcMisses"
+    };
+
+    /// Counter values of one measured phase. Counters the kernel or the CPU does not provide are not valid.
+    struct PerfSample {
+        std::array<uint64_t, PERF_EventCount> values{};
+        std::array<bool, PERF_EventCount> valid{};
+
+        [[nodiscard]] bool has(PerfEvent event) const { return valid[event]; }
+
+        [[nodiscard]] double ipc() const {
+            return has(PERF_Cycles) && has(PERF_Instructions) && values[PERF_Cycles]
+                ? static_cast<double>(values[PERF_Instructions]) / static_cast<double>(values[PERF_Cycles]) : 0;
+        }
+
+        [[nodiscard]] double perNode(PerfEvent event, uint64_t nodes) const {
+            return nodes ? static_cast<double>(values[event]) / static_cast<double>(nodes) : 0;
+        }
+    };
+
+    /**
+     * Hardware performance counters of the calling thread via perf_event_open, counting user space only.
+     * Every event is opened on its own, so a missing event (common in virtual machines) does not disable the others.
+     * Without DORY_PERF_COUNTERS, or if the kernel refuses access (see /proc/sys/kernel/perf_event_paranoid),
+     * no counter is available and all samples are empty.
+     */
+    class PerfCounters {
+        std::array<int, PERF_EventCount> fds{-1, -1, -1, -1, -1};
+
+#if defined(DORY_PERF_COUNTERS) && defined(__linux__)
+        static int open(uint32_t type, uint64_t config) {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = type;
+            attr.config = config;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+
+        static constexpr uint64_t cacheReadMiss(uint64_t cache) {
+            return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        }
+#endif
+
+    public:
+        PerfCounters() {
+#if defined(DORY_PERF_COUNTERS) && defined(__linux__)
+            fds[PERF_Cycles] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+            fds[PERF_Instructions] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+            fds[PERF_BranchMisses] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+            fds[PERF_L1DMisses] = open(PERF_TYPE_HW_CACHE, cacheReadMiss(PERF_COUNT_HW_CACHE_L1D));
+            fds[PERF_LLCMisses] = open(PERF_TYPE_HW_CACHE, cacheReadMiss(PERF_COUNT_HW_CACHE_LL));
+#endif
+        }
+
+        PerfCounters(const PerfCounters&) = delete;
+        PerfCounters& operator=(const PerfCounters&) = delete;
+
+        ~PerfCounters() {
+#if defined(DORY_PERF_COUNTERS) && defined(__linux__)
+            for (int fd: fds) if (fd >= 0) close(fd);
+#endif
+        }
+
+        [[nodiscard]] bool available() const {
+            for (int fd: fds) if (fd >= 0) return true;
+            return false;
+        }
+
+        void start() {
+#if defined(DORY_PERF_COUNTERS) && defined(__linux__)
+            for (int fd: fds) {
+                if (fd < 0) continue;
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+#endif
+        }
+
+        /// Stops counting and returns the counts since start(), scaled up if the kernel multiplexed a counter
+        PerfSample stop() {
+            PerfSample sample;
+#if defined(DORY_PERF_COUNTERS) && defined(__linux__)
+            for (int fd: fds) if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            for (size_t i = 0; i < PERF_EventCount; i++) {
+                uint64_t data[3];   // value, time enabled, time running
+                if (fds[i] < 0 || read(fds[i], data, sizeof(data)) != sizeof(data) || data[2] == 0) continue;
+                sample.values[i] = data[2] < data[1]
+                    ? static_cast<uint64_t>(static_cast<double>(data[0]) * data[1] / data[2]) : data[0];
+                sample.valid[i] = true;
+            }
+#endif
+            return sample;
+        }
+    };
+
+    /// One line per phase with the raw counts, the IPC and every counter per node
+    void printPerfSample(std::ostream& out, std::string_view phase, const PerfSample& sample, uint64_t nodes) {
+        out << phase << ":\t" << nodes << " nodes";
+        if (sample.has(PERF_Cycles) && sample.has(PERF_Instructions)) out << "\tIPC " << sample.ipc();
+        for (size_t i = 0; i < PERF_EventCount; i++) {
+            if (!sample.valid[i]) continue;
+            auto event = static_cast<PerfEvent>(i);
+            out << '\t' << PERF_EVENT_NAMES[i] << ' ' << sample.values[i] << " (" << sample.perNode(event, nodes)
+                << "/node)";
+        }
+        out << '\n';
+    }
+
+} // namespace Dory::Utils
+
+#endif //DORY_PERFCOUNTERS_H
@@ -0,0 +1,273 @@
+#ifndef DORY_PGN_H
+#define DORY_PGN_H
+
+#include <atomic>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "fenreader.h"
+#include "san.h"
+
+namespace Dory::Utils {
+
+    /**
+     * One game of a PGN file. Tag names and values point into the input buffer of the reader.
+     */
+    struct PGNGame {
+        std::vector<std::pair<std::string_view, std::string_view>> tags;
+        Board startBoard{STARTBOARD};
+        bool startWhite{true};
+        std::vector<Move> moves;
+        std::string_view result;
+        const char* error{nullptr};   // set if the game could not be replayed completely
+
+        [[nodiscard]] std::string_view tag(std::string_view name) const {
+            for (auto& [key, value]: tags) {
+                if (key == name) return value;
+            }
+            return {};
+        }
+
+        void clear() {
+            tags.clear();
+            moves.clear();
+            startBoard = STARTBOARD;
+            startWhite = true;
+            result = {};
+            error = nullptr;
+        }
+
+        /**
+         * Calls f(board, whiteToMove, move) for every position of the game together with the move played in it.
+         */
+        template<typename F>
+        void replay(F&& f) const {
+            Board board = startBoard;
+            bool whiteToMove = startWhite;
+            for (const Move& move: moves) {
+                f(static_cast<const Board&>(board), whiteToMove, move);
+                board.makeMove(move, whiteToMove);
+                whiteToMove = !whiteToMove;
+            }
+        }
+    };
+
+    /**
+     * Reads the games of a PGN text one by one without copying it. Comments, variations, NAGs and escaped lines
+     * are skipped. A game with an illegal or unreadable move keeps the moves up to that point and sets 'error'.
+     */
+    class PGNReader {
+        std::string_view data;
+        size_t pos{0};
+        MoveCollectors::MoveList list;
+
+    public:
+        explicit PGNReader(std::string_view input) : data{input} {}
+
+        /**
+         * Reads the next game into 'game'.
+         *
+         * @return false once the input is exhausted
+         */
+        bool next(PGNGame& game) {
+            game.clear();
+            skipWhitespace();
+            if (pos >= data.size()) return false;
+
+            while (pos < data.size() && data[pos] == '[') {
+                readTag(game);
+                skipWhitespace();
+            }
+
+            std::string_view fen = game.tag("FEN");
+            if (!fen.empty() && parseFEN(fen, game.startBoard, game.startWhite)) {
+                game.error = "invalid FEN tag";
+            }
+
+            Board board = game.startBoard;
+            bool whiteToMove = game.startWhite;
+            readMovetext(game, board, whiteToMove);
+            return true;
+        }
+
+        [[nodiscard]] size_t position() const { return pos; }
+
+    private:
+        [[nodiscard]] bool atLineStart() const {
+            return pos == 0 || data[pos - 1] == '\n';
+        }
+
+        void skipUntil(char c) {
+            size_t end = data.find(c, pos);
+            pos = end == std::string_view::npos ? data.size() : end + 1;
+        }
+
+        void skipWhitespace() {
+            while (pos < data.size()) {
+                char c = data[pos];
+                if (c == ' ' || c == '\n' || c == '\r' || c == '\t') pos++;
+                else if (c == '%' && atLineStart()) skipUntil('\n');
+                else break;
+            }
+        }
+
+        void readTag(PGNGame& game) {
+            size_t end = data.find('\n', pos);
+            std::string_view line = data.substr(pos, end == std::string_view::npos ? std::string_view::npos : end - pos);
+            pos = end == std::string_view::npos ? data.size() : end + 1;
+
+            size_t nameEnd = line.find(' ');
+            size_t open = line.find('"'), close = line.rfind('"');
+            if (nameEnd == std::string_view::npos || open == std::string_view::npos || close <= open) return;
+            game.tags.emplace_back(line.substr(1, nameEnd - 1), line.substr(open + 1, close - open - 1));
+        }
+
+        /// Skips a variation, which may contain nested variations and comments
+        void skipVariation() {
+            int nesting = 0;
+            while (pos < data.size()) {
+                char c = data[pos++];
+                if (c == '(') nesting++;
+                else if (c == ')' && --nesting == 0) return;
+                else if (c == '{') skipUntil('}');
+            }
+        }
+
+        static bool isDelimiter(char c) {
+            return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '{' || c == '}' || c == '(' || c == ')'
+                   || c == ';' || c == '[' || c == '$';
+        }
+
+        void readMovetext(PGNGame& game, Board& board, bool& whiteToMove) {
+            while (true) {
+                skipWhitespace();
+                if (pos >= data.size()) return;
+
+                char c = data[pos];
+                if (c == '[' && atLineStart()) return;  // next game without result token
+                if (c == '{') { skipUntil('}'); continue; }
+                if (c == ';') { skipUntil('\n'); continue; }
+                if (c == '(') { skipVariation(); continue; }
+                if (c == '$' || c == ')' || c == '}' || c == '[') {
+                    pos++;
+                    while (pos < data.size() && data[pos] >= '0' && data[pos] <= '9') pos++;
+                    continue;
+                }
+
+                size_t start = pos;
+                while (pos < data.size() && !isDelimiter(data[pos])) pos++;
+                std::string_view token = data.substr(start, pos - start);
+
+                if (token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*") {
+                    game.result = token;
+                    return;
+                }
+
+                // move numbers, possibly followed by a move without a space ("12.e4", "12...Nf6")
+                size_t digits = 0;
+                while (digits < token.size() && token[digits] >= '0' && token[digits] <= '9') digits++;
+                if (digits > 0 && digits < token.size() && token[digits] == '.') {
+                    token.remove_prefix(digits);
+                    while (!token.empty() && token.front() == '.') token.remove_prefix(1);
+                }
+                if (token.empty() || game.error) continue;
+
+                Move move = whiteToMove ? parseSAN<true>(board, token, list) : parseSAN<false>(board, token, list);
+                if (move == NULLMOVE) {
+                    game.error = "illegal or ambiguous move";
+                    continue;
+                }
+                game.moves.push_back(move);
+                board.makeMove(move, whiteToMove);
+                whiteToMove = !whiteToMove;
+            }
+        }
+    };
+
+    /**
+     * Read-only memory mapping of a whole file. 'advice' is passed to madvise, files read at random offsets should
+     * use MADV_RANDOM to avoid useless read-ahead.
+     */
+    class MappedFile {
+        const char* ptr{nullptr};
+        size_t length{0};
+
+    public:
+        explicit MappedFile(const std::string& path, int advice = MADV_SEQUENTIAL) {
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0) return;
+            struct stat st{};
+            if (fstat(fd, &st) == 0 && st.st_size > 0) {
+                void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapped != MAP_FAILED) {
+                    madvise(mapped, st.st_size, advice);
+                    ptr = static_cast<const char*>(mapped);
+                    length = st.st_size;
+                }
+            }
+            close(fd);
+        }
+
+        ~MappedFile() {
+            if (ptr) munmap(const_cast<char*>(ptr), length);
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        [[nodiscard]] bool isOpen() const { return ptr != nullptr; }
+
+        [[nodiscard]] std::string_view view() const { return {ptr, length}; }
+    };
+
+    /**
+     * Splits a PGN text into 'parts' slices that start at game boundaries ("[Event" at the start of a line).
+     */
+    std::vector<std::string_view> splitPGN(std::string_view data, size_t parts) {
+        std::vector<std::string_view> slices;
+        size_t start = 0;
+        for (size_t p = 1; p < parts && start < data.size(); p++) {
+            size_t split = data.find("\n[Event ", std::max(start, data.size() * p / parts));
+            if (split == std::string_view::npos) break;
+            slices.push_back(data.substr(start, split + 1 - start));
+            start = split + 1;
+        }
+        slices.push_back(data.substr(start));
+        return slices;
+    }
+
+    /**
+     * Reads all games of a PGN text on 'numThreads' threads. onGame(game, thread) is called concurrently from all
+     * threads, games of one slice are reported in order.
+     *
+     * @return the number of games read
+     */
+    template<typename F>
+    size_t readPGNParallel(std::string_view data, size_t numThreads, F&& onGame) {
+        std::vector<std::string_view> slices = splitPGN(data, std::max<size_t>(numThreads, 1));
+        std::atomic<size_t> games{0};
+        std::vector<std::thread> threads;
+
+        for (size_t t = 0; t < slices.size(); t++) {
+            threads.emplace_back([&, t]() {
+                PGNReader reader{slices[t]};
+                PGNGame game;
+                size_t count = 0;
+                while (reader.next(game)) {
+                    onGame(static_cast<const PGNGame&>(game), t);
+                    count++;
+                }
+                games += count;
+            });
+        }
+        for (auto& thread: threads) thread.join();
+        return games;
+    }
+
+} // namespace Dory::Utils
+
+#endif //DORY_PGN_H
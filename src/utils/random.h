@@ -56,6 +56,36 @@ namespace Dory::Utils {
             return dist(rng) <= p;
         }
     };
+
+    /**
+     * wyrand generator. Much faster than mt19937 and good enough for random playouts.
+     */
+    class WyRand {
+        uint64_t state;
+
+    public:
+        explicit WyRand(uint64_t seed = std::random_device{}()) : state{seed} {}
+
+        void setSeed(uint64_t s) {
+            state = s;
+        }
+
+        uint64_t next() {
+            state += 0xa0761d6478bd642full;
+            __uint128_t t = static_cast<__uint128_t>(state) * (state ^ 0xe7037ed1a0b428dbull);
+            return static_cast<uint64_t>(t >> 64) ^ static_cast<uint64_t>(t);
+        }
+
+        /// Number in [0, n), slightly biased for large n
+        uint32_t below(uint32_t n) {
+            return static_cast<uint32_t>(((next() & 0xffffffffull) * n) >> 32);
+        }
+
+        /// True with probability 'p', always for p >= 1. Compares 53 random bits, which a double holds exactly.
+        bool chance(double p) {
+            return static_cast<double>(next() >> 11) < p * 0x1p53;
+        }
+    };
 }
 
 #endif //DORY_RANDOM_H
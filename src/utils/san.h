@@ -0,0 +1,197 @@
+#ifndef DORY_SAN_H
+#define DORY_SAN_H
+
+#include <span>
+#include <string>
+
+#include "../core/movecollectors.h"
+#include "utils.h"
+
+namespace Dory::Utils {
+
+    /**
+     * Finds the legal move described by a SAN string such as "Nbd7", "exd6", "e8=Q+" or "O-O-O".
+     * Check and annotation suffixes are ignored.
+     *
+     * @return NULLMOVE if no legal move or more than one legal move matches
+     */
+    template<bool whiteToMove>
+    Move parseSAN(Board& board, std::string_view san, MoveCollectors::MoveList& list) {
+        while (!san.empty() && (san.back() == '+' || san.back() == '#' || san.back() == '!' || san.back() == '?')) {
+            san.remove_suffix(1);
+        }
+        if (san.size() < 2) return NULLMOVE;
+
+        list.generate<whiteToMove>(board);
+
+        if (san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0") {
+            const Flag_t castling = san.size() == 3 ? MOVEFLAG_ShortCastling : MOVEFLAG_LongCastling;
+            for (const Move& move: list) {
+                if (move.flags == castling) return move;
+            }
+            return NULLMOVE;
+        }
+
+        Piece_t piece = PIECE_Pawn;
+        switch (san.front()) {
+            case 'N': piece = PIECE_Knight; break;
+            case 'B': piece = PIECE_Bishop; break;
+            case 'R': piece = PIECE_Rook; break;
+            case 'Q': piece = PIECE_Queen; break;
+            case 'K': piece = PIECE_King; break;
+            default: break;
+        }
+        if (piece != PIECE_Pawn) san.remove_prefix(1);
+
+        Flag_t promotion = MOVEFLAG_Silent;
+        if (piece == PIECE_Pawn) {
+            switch (san.back()) {
+                case 'Q': promotion = MOVEFLAG_PromoteQueen; break;
+                case 'R': promotion = MOVEFLAG_PromoteRook; break;
+                case 'B': promotion = MOVEFLAG_PromoteBishop; break;
+                case 'N': promotion = MOVEFLAG_PromoteKnight; break;
+                default: break;
+            }
+            if (promotion != MOVEFLAG_Silent) {
+                san.remove_suffix(1);
+                if (!san.empty() && san.back() == '=') san.remove_suffix(1);
+            }
+        }
+
+        if (san.size() < 2) return NULLMOVE;
+        const char toFile = san[san.size() - 2], toRank = san.back();
+        if (toFile < 'a' || toFile > 'h' || toRank < '1' || toRank > '8') return NULLMOVE;
+        const int toIx = 8 * (toRank - '1') + (toFile - 'a');
+
+        int fromFile = -1, fromRank = -1;
+        for (char c: san.substr(0, san.size() - 2)) {
+            if (c >= 'a' && c <= 'h') fromFile = c - 'a';
+            else if (c >= '1' && c <= '8') fromRank = c - '1';
+            else if (c != 'x' && c != '-') return NULLMOVE;
+        }
+
+        Move match = NULLMOVE;
+        for (const Move& move: list) {
+            if (move.piece != piece || move.toIndex != toIx) continue;
+            if (move.flags == MOVEFLAG_ShortCastling || move.flags == MOVEFLAG_LongCastling) continue;
+            if (fromFile >= 0 && fileOf(move.fromIndex) != fromFile) continue;
+            if (fromRank >= 0 && rankOf(move.fromIndex) != fromRank) continue;
+            if (promotion != MOVEFLAG_Silent ? move.flags != promotion : move.isPromotion()) continue;
+
+            if (match != NULLMOVE) return NULLMOVE;  // ambiguous
+            match = move;
+        }
+        return match;
+    }
+
+    Move parseSAN(Board& board, bool whiteToMove, std::string_view san) {
+        MoveCollectors::MoveList list;
+        if (whiteToMove) return parseSAN<true>(board, san, list);
+        return parseSAN<false>(board, san, list);
+    }
+
+    // Longest SAN of a move ("Qa1xb2+", "exd8=Q#") including a terminating zero
+    constexpr size_t MAX_SAN_LENGTH = 8;
+
+    /**
+     * Writes the SAN of a legal move into 'buffer', which must hold at least MAX_SAN_LENGTH characters.
+     * The origin is only added where another piece of the same type can reach the target square, '+' and '#'
+     * are appended for checks and checkmates.
+     *
+     * @return the length of the SAN, excluding the terminating zero
+     */
+    template<bool whiteToMove>
+    size_t toSAN(const Board& board, Move move, char* buffer, MoveCollectors::MoveList& list) {
+        char* out = buffer;
+        auto square = [&out](int ix) {
+            *out++ = static_cast<char>('a' + fileOf(ix));
+            *out++ = static_cast<char>('1' + rankOf(ix));
+        };
+
+        Board B{board};
+        if (move.flags == MOVEFLAG_ShortCastling || move.flags == MOVEFLAG_LongCastling) {
+            for (char c: std::string_view{move.flags == MOVEFLAG_ShortCastling ? "O-O" : "O-O-O"}) *out++ = c;
+        } else {
+            const bool capture = B.isCapture<whiteToMove>(move) || move.flags == MOVEFLAG_EnPassantCapture;
+            if (move.piece == PIECE_Pawn) {
+                if (capture) *out++ = static_cast<char>('a' + fileOf(move.fromIndex));
+            } else {
+                *out++ = "QRBNPK"[move.piece];
+
+                bool ambiguous = false, sameFile = false, sameRank = false;
+                if (move.piece != PIECE_King) {
+                    list.generate<whiteToMove>(B);
+                    for (const Move& other: list) {
+                        if (other.piece != move.piece || other.toIndex != move.toIndex
+                            || other.fromIndex == move.fromIndex) continue;
+                        ambiguous = true;
+                        sameFile |= fileOf(other.fromIndex) == fileOf(move.fromIndex);
+                        sameRank |= rankOf(other.fromIndex) == rankOf(move.fromIndex);
+                    }
+                }
+                if (ambiguous && (!sameFile || sameRank)) *out++ = static_cast<char>('a' + fileOf(move.fromIndex));
+                if (ambiguous && sameFile) *out++ = static_cast<char>('1' + rankOf(move.fromIndex));
+            }
+            if (capture) *out++ = 'x';
+            square(move.toIndex);
+
+            if (move.isPromotion()) {
+                *out++ = '=';
+                *out++ = "QRBN"[move.flags - MOVEFLAG_PromoteQueen];
+            }
+        }
+
+        B.makeMove<whiteToMove>(move);
+        CheckLogicHandler::reload<!whiteToMove>(B, list.pd);
+        if (list.pd.inCheck()) {
+            list.generate<!whiteToMove>(B);
+            *out++ = list.count ? '+' : '#';
+        }
+        *out = '\0';
+        return out - buffer;
+    }
+
+    size_t toSAN(const Board& board, bool whiteToMove, Move move, char* buffer) {
+        MoveCollectors::MoveList list;
+        if (whiteToMove) return toSAN<true>(board, move, buffer, list);
+        return toSAN<false>(board, move, buffer, list);
+    }
+
+    std::string toSAN(const Board& board, bool whiteToMove, Move move) {
+        char buffer[MAX_SAN_LENGTH];
+        size_t length = toSAN(board, whiteToMove, move, buffer);
+        return {buffer, length};
+    }
+
+    /**
+     * Writes a principal variation as space separated SAN into 'buffer' of size 'capacity'. The line is given in the
+     * order the search stores it, the first move last. Moves that do not fit are left out.
+     *
+     * @return the length of the written text, excluding the terminating zero
+     */
+    size_t lineToSAN(const Board& board, bool whiteToMove, std::span<const Move> line, char* buffer, size_t capacity) {
+        MoveCollectors::MoveList list;
+        Board B{board};
+        size_t length = 0;
+        if (capacity == 0) return 0;
+
+        for (auto it = line.rbegin(); it != line.rend(); ++it) {
+            if (length + MAX_SAN_LENGTH + 1 > capacity) break;
+            if (length) buffer[length++] = ' ';
+            length += whiteToMove ? toSAN<true>(B, *it, buffer + length, list) : toSAN<false>(B, *it, buffer + length, list);
+            B.makeMove(*it, whiteToMove);
+            whiteToMove = !whiteToMove;
+        }
+        buffer[length] = '\0';
+        return length;
+    }
+
+    std::string lineToSAN(const Board& board, bool whiteToMove, std::span<const Move> line) {
+        std::string result(line.size() * MAX_SAN_LENGTH + 1, '\0');
+        result.resize(lineToSAN(board, whiteToMove, line, result.data(), result.size()));
+        return result;
+    }
+
+} // namespace Dory::Utils
+
+#endif //DORY_SAN_H
@@ -6,6 +6,7 @@
 #define DORY_UTILS_H
 
 #include <array>
+#include <charconv>
 #include <chrono>
 #include <vector>
 #include <ranges>
@@ -39,6 +40,21 @@ namespace Dory::Utils {
         return squarename(fileOf(index), rankOf(index));
     }
 
+    /**
+     * Parses a non-negative number that makes up all of 'text', false if it is malformed or out of range.
+     */
+    template<typename T>
+    bool parseNumber(std::string_view text, T& out) {
+        T parsed{};
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), parsed);
+        if (error != std::errc{} || end != text.data() + text.size()) return false;
+        if constexpr (std::is_signed_v<T>) {
+            if (parsed < 0) return false;
+        }
+        out = parsed;
+        return true;
+    }
+
 
     void add_piece(ByteBoard &byteboard, BB pieces, char letter) {
         BB selector = 1;
@@ -247,20 +263,6 @@ namespace Dory::Utils {
 //            MoveGenerator<QuickCollector>::template queenMoves<whiteToMove>(board);
 //        }
 //        return QuickCollector::targets;
-//    }
-//
-//    std::string disambiguationChar(Move m, const Board& board) {
-//        Piece_t piece = m.piece;
-//
-//    }
-
-//    std::string moveNameShortForBoard(Move m, const Board& board) {
-//        std::stringstream bss{};
-//        if (m.flags == MOVEFLAG_ShortCastling) bss << specialMove(MOVEFLAG_ShortCastling);
-//        else if (m.flags == MOVEFLAG_LongCastling) bss << specialMove(MOVEFLAG_LongCastling);
-//        else bss << pieceString(m.piece) << squarename(m.to());
-//        bss << promotionsFlag(m.flags);
-//        return bss.str();
 //    }
 
     std::string moveFullNotation(Move m) {
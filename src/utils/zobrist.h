@@ -11,6 +11,7 @@
 
 namespace Dory::Zobrist {
 
+    // indexed by square and Piece_t, offset by 6 for black pieces
     static std::array<std::array<BB, 12>, 64> BITSTRINGS{};
     static BB black_to_move_bitstring;
     static Utils::Random random;
@@ -31,36 +32,49 @@ namespace Dory::Zobrist {
         if constexpr (!whiteToMove)
             h ^= black_to_move_bitstring;
 
+#ifdef DORY_MAILBOX
+        BB occ = board.occ();
+        Bitloop(occ) {
+            const int sq = firstBitOf(occ);
+            const uint8_t code = board.mailbox[sq];
+            h ^= BITSTRINGS[sq][(code & ~MAILBOX_Black) + (code & MAILBOX_Black ? 6 : 0)];
+        }
+#else
         for(int sq = 0; sq < 64; ++sq) {
             if(hasBitAt(board.wPawns, sq))
-                h ^= BITSTRINGS [sq][0];
+                h ^= BITSTRINGS [sq][PIECE_Pawn];
             else if(hasBitAt(board.wKnights, sq))
-                h ^= BITSTRINGS [sq][1];
+                h ^= BITSTRINGS [sq][PIECE_Knight];
             else if(hasBitAt(board.wBishops, sq))
-                h ^= BITSTRINGS [sq][2];
+                h ^= BITSTRINGS [sq][PIECE_Bishop];
             else if(hasBitAt(board.wRooks, sq))
-                h ^= BITSTRINGS [sq][3];
+                h ^= BITSTRINGS [sq][PIECE_Rook];
             else if(hasBitAt(board.wQueens, sq))
-                h ^= BITSTRINGS [sq][4];
+                h ^= BITSTRINGS [sq][PIECE_Queen];
             else if(sq == board.wKingSq)
-                h ^= BITSTRINGS [sq][5];
+                h ^= BITSTRINGS [sq][PIECE_King];
             else if(hasBitAt(board.bPawns, sq))
-                h ^= BITSTRINGS [sq][6];
+                h ^= BITSTRINGS [sq][6 + PIECE_Pawn];
             else if(hasBitAt(board.bKnights, sq))
-                h ^= BITSTRINGS [sq][7];
+                h ^= BITSTRINGS [sq][6 + PIECE_Knight];
             else if(hasBitAt(board.bBishops, sq))
-                h ^= BITSTRINGS [sq][8];
+                h ^= BITSTRINGS [sq][6 + PIECE_Bishop];
             else if(hasBitAt(board.bRooks, sq))
-                h ^= BITSTRINGS [sq][9];
+                h ^= BITSTRINGS [sq][6 + PIECE_Rook];
             else if(hasBitAt(board.bQueens, sq))
-                h ^= BITSTRINGS [sq][10];
+                h ^= BITSTRINGS [sq][6 + PIECE_Queen];
             else if(sq == board.bKingSq)
-                h ^= BITSTRINGS [sq][11];
+                h ^= BITSTRINGS [sq][6 + PIECE_King];
         }
+#endif
 
         return h;
     }
 
+    BB hash(const Board& board, bool whiteToMove) {
+        return whiteToMove ? hash<true>(board) : hash<false>(board);
+    }
+
 } // namespace Dory::Zobrist
 
 #endif //DORY_ZOBRIST_H
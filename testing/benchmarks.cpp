@@ -0,0 +1,239 @@
+#include <fstream>
+#include <random>
+
+#include <benchmark/benchmark.h>
+
+#include "../src/dory.h"
+#include "../src/utils/perfcounters.h"
+
+/**
+ * Microbenchmarks of the individual components of move generation and search, so that regressions show up per
+ * component rather than only in the overall speed.
+ *
+ * Usage: ./bench [google benchmark flags] [positions file, default ../resources/equalPositions.txt]
+ *
+ * Builds with DORY_PERF_COUNTERS additionally report the IPC and the hardware counters per item of the benchmarks
+ * of move generation, evaluation, the transposition table and search.
+ */
+namespace Dory::Benchmarks {
+
+    std::string positionsPath = "../resources/equalPositions.txt";
+
+    // positions by type for move generation and make / unmake
+    const char* const STARTPOS = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+    const char* const MIDDLEGAME = "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1";
+    const char* const ENDGAME = "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1";
+    const char* const IN_CHECK = "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1";
+    const char* const PROMOTIONS = "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1";
+
+    const std::vector<Position>& positions() {
+        static const std::vector<Position> loaded = [] {
+            std::vector<Position> result;
+            std::ifstream file(positionsPath);
+            std::string line;
+            while (std::getline(file, line)) {
+                if (line.size() >= 3 && line.compare(0, 3, "\xEF\xBB\xBF") == 0) line.erase(0, 3);  // UTF-8 BOM
+                while (!line.empty() && std::isspace(static_cast<unsigned char>(line.back()))) line.pop_back();
+                Position position;
+                if (!line.empty() && !Utils::parseFEN(line, position.first, position.second)) result.push_back(position);
+            }
+            return result;
+        }();
+        return loaded;
+    }
+
+    /**
+     * Counts the hardware events of the benchmark loop while in scope and adds them to the counters of the
+     * benchmark, divided by the number of items processed. Does nothing without DORY_PERF_COUNTERS.
+     */
+    class PerfScope {
+        benchmark::State& state;
+        Utils::PerfCounters counters;
+
+    public:
+        explicit PerfScope(benchmark::State& s) : state{s} {
+            if constexpr (Utils::PERF_COUNTERS) counters.start();
+        }
+
+        ~PerfScope() {
+            if constexpr (!Utils::PERF_COUNTERS) return;
+            const Utils::PerfSample sample = counters.stop();
+            const auto items = static_cast<uint64_t>(state.items_processed());
+            if (sample.has(Utils::PERF_Cycles) && sample.has(Utils::PERF_Instructions)) state.counters["IPC"] = sample.ipc();
+            for (size_t i = 0; i < Utils::PERF_EventCount; i++) {
+                if (!sample.valid[i]) continue;
+                state.counters[std::string{Utils::PERF_EVENT_NAMES[i]} + "/item"] =
+                        sample.perNode(static_cast<Utils::PerfEvent>(i), items);
+            }
+        }
+    };
+
+    /// Calls f with the side to move as a compile-time constant
+    template<typename F>
+    void withSide(bool whiteToMove, F&& f) {
+        if (whiteToMove) f(std::true_type{});
+        else f(std::false_type{});
+    }
+
+    void BM_GenerateMoves(benchmark::State& state, const char* fen) {
+        auto [board, whiteToMove] = Utils::parseFEN(fen);
+        MoveCollectors::MoveList list;
+        PerfScope perf{state};
+        withSide(whiteToMove, [&](auto white) {
+            for (auto _: state) {
+                list.generate<white>(board);
+                benchmark::DoNotOptimize(list.count);
+            }
+        });
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * list.count));
+    }
+    BENCHMARK_CAPTURE(BM_GenerateMoves, startpos, STARTPOS);
+    BENCHMARK_CAPTURE(BM_GenerateMoves, middlegame, MIDDLEGAME);
+    BENCHMARK_CAPTURE(BM_GenerateMoves, endgame, ENDGAME);
+    BENCHMARK_CAPTURE(BM_GenerateMoves, inCheck, IN_CHECK);
+    BENCHMARK_CAPTURE(BM_GenerateMoves, promotions, PROMOTIONS);
+
+    void BM_MakeUnmake(benchmark::State& state, const char* fen) {
+        auto [board, whiteToMove] = Utils::parseFEN(fen);
+        MoveCollectors::MoveList list;
+        list.generate(board, whiteToMove);
+        withSide(whiteToMove, [&](auto white) {
+            for (auto _: state) {
+                for (const Move& move: list) {
+                    RestoreInfo ri = board.makeMove<white>(move);
+                    benchmark::DoNotOptimize(board);
+                    board.unmakeMove<white>(move, ri);
+                }
+            }
+        });
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * list.count));
+    }
+    BENCHMARK_CAPTURE(BM_MakeUnmake, middlegame, MIDDLEGAME);
+    BENCHMARK_CAPTURE(BM_MakeUnmake, promotions, PROMOTIONS);
+
+    void BM_Fork(benchmark::State& state, const char* fen) {
+        auto [board, whiteToMove] = Utils::parseFEN(fen);
+        MoveCollectors::MoveList list;
+        list.generate(board, whiteToMove);
+        withSide(whiteToMove, [&](auto white) {
+            for (auto _: state) {
+                for (const Move& move: list) {
+                    Board next = board.fork<white>(move);
+                    benchmark::DoNotOptimize(next);
+                }
+            }
+        });
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * list.count));
+    }
+    BENCHMARK_CAPTURE(BM_Fork, middlegame, MIDDLEGAME);
+    BENCHMARK_CAPTURE(BM_Fork, promotions, PROMOTIONS);
+
+    /// Runs f(board, white) on every position of the positions file per iteration
+    template<typename F>
+    void overPositions(benchmark::State& state, F&& f) {
+        std::vector<Position> boards = positions();
+        if (boards.empty()) {
+            state.SkipWithError("no positions loaded");
+            return;
+        }
+        PerfScope perf{state};
+        for (auto _: state) {
+            for (auto& [board, whiteToMove]: boards) {
+                withSide(whiteToMove, [&](auto white) { f(board, white); });
+            }
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * boards.size()));
+    }
+
+    void BM_Evaluate(benchmark::State& state) {
+        overPositions(state, [](Board& board, auto white) {
+            benchmark::DoNotOptimize(evaluation::evaluatePosition<white>(board));
+        });
+    }
+    BENCHMARK(BM_Evaluate);
+
+    void BM_ZobristHash(benchmark::State& state) {
+        overPositions(state, [](Board& board, auto white) {
+            benchmark::DoNotOptimize(Zobrist::hash<white>(board));
+        });
+    }
+    BENCHMARK(BM_ZobristHash);
+
+    void BM_CheckLogicReload(benchmark::State& state) {
+        PinData pd;
+        overPositions(state, [&pd](Board& board, auto white) {
+            CheckLogicHandler::reload<white>(board, pd);
+            benchmark::DoNotOptimize(pd);
+        });
+    }
+    BENCHMARK(BM_CheckLogicReload);
+
+    /// Keys of 'count' random positions, the table holds all of them before probing
+    std::vector<uint64_t> randomKeys(size_t count) {
+        std::mt19937_64 rng{12345};
+        std::vector<uint64_t> keys(count);
+        for (auto& key: keys) key = rng();
+        return keys;
+    }
+
+    void BM_TTStore(benchmark::State& state) {
+        const std::vector<uint64_t> keys = randomKeys(state.range(0));
+        TranspositionTable table;
+        for (auto _: state) {
+            for (uint64_t key: keys) table.insert(key, static_cast<int>(key & 0xFF), NULLPACKEDMOVE, 3, -100, 100);
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * keys.size()));
+    }
+    BENCHMARK(BM_TTStore)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+
+    void BM_TTProbe(benchmark::State& state) {
+        const std::vector<uint64_t> keys = randomKeys(state.range(0));
+        TranspositionTable table;
+        for (uint64_t key: keys) table.insert(key, static_cast<int>(key & 0xFF), NULLPACKEDMOVE, 3, -100, 100);
+        PerfScope perf{state};
+        for (auto _: state) {
+            for (uint64_t key: keys) {
+                int alpha = -100, beta = 100;
+                benchmark::DoNotOptimize(table.lookup(key, alpha, beta, 2));
+            }
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * keys.size()));
+    }
+    BENCHMARK(BM_TTProbe)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+
+    /// Fixed-depth searches of the first 16 positions of the positions file, each with a cleared searcher
+    void BM_Search(benchmark::State& state) {
+        std::vector<Position> boards = positions();
+        boards.resize(std::min<size_t>(boards.size(), 16));
+        if (boards.empty()) {
+            state.SkipWithError("no positions loaded");
+            return;
+        }
+        const int depth = static_cast<int>(state.range(0));
+        Search::Searcher searcher{};
+        uint64_t nodes{0};
+        PerfScope perf{state};
+        for (auto _: state) {
+            for (auto& [board, whiteToMove]: boards) {
+                withSide(whiteToMove, [&](auto white) {
+                    benchmark::DoNotOptimize(searcher.iterativeDeepening<white>(board, depth));
+                });
+                nodes += searcher.nodesSearched;
+            }
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(nodes));
+        state.counters["nodes"] = benchmark::Counter(static_cast<double>(nodes), benchmark::Counter::kAvgIterations);
+        state.counters["nps"] = benchmark::Counter(static_cast<double>(nodes), benchmark::Counter::kIsRate);
+    }
+    BENCHMARK(BM_Search)->Arg(3)->Arg(4)->Arg(5)->Unit(benchmark::kMillisecond);
+
+} // namespace Dory::Benchmarks
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (argc > 1) Dory::Benchmarks::positionsPath = argv[1];
+    Dory::Zobrist::init(23984729);
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -3,6 +3,7 @@
 //
 
 #include <gtest/gtest.h>
+#include <filesystem>
 #include <fstream>
 #include "../src/dory.h"
 
@@ -57,27 +58,493 @@ namespace Dory::Testing {
         auto [fen, solution] = GetParam();
         auto [board, whiteToMove] = Utils::parseFEN(fen);
 
-        std::string output;
-        if (whiteToMove) {
-            auto [_, line] = dory->searchDepth<true>(board, MAX_SEARCH_DEPTH);
-            output = Utils::moveNameShortNotation(line.back());
-        } else {
-            auto [_, line] = dory->searchDepth<false>(board, MAX_SEARCH_DEPTH);
-            output = Utils::moveNameShortNotation(line.back());
+        auto [_, line] = dory->searchDepth(board, MAX_SEARCH_DEPTH, whiteToMove);
+
+        // solutions omit capture and check markers and are not always disambiguated
+        Move expected = Utils::parseSAN(board, whiteToMove, solution);
+        if (expected == NULLMOVE) ASSERT_EQ(Utils::moveNameShortNotation(line.back()), solution);
+        else ASSERT_EQ(Utils::toSAN(board, whiteToMove, line.back()), Utils::toSAN(board, whiteToMove, expected))
+            << Utils::lineToSAN(board, whiteToMove, line);
+    }
+
+    TEST(EngineBatch, MatchesSerialSearch) {
+        const int depth = 4;
+        std::vector<std::string> fens;
+        for (auto& [fen, _]: loadTestCases(0, 8)) fens.push_back(fen);
+
+        Engine engine{};
+        std::vector<size_t> finished;
+        auto results = engine.analyzeBatch(std::span<const std::string>{fens}, {depth}, 3,
+                                           [&finished](size_t ix, const Result&) { finished.push_back(ix); });
+
+        ASSERT_EQ(results.size(), fens.size());
+        ASSERT_EQ(finished.size(), fens.size());
+        for (size_t ix = 0; ix < fens.size(); ix++) {
+            auto [board, whiteToMove] = Utils::parseFEN(fens[ix]);
+            Search::Searcher serial{};
+            Result expected = whiteToMove ? serial.iterativeDeepening<true>(board, depth)
+                                          : serial.iterativeDeepening<false>(board, depth);
+            ASSERT_EQ(results[ix].eval, expected.eval);
+            ASSERT_EQ(results[ix].line, expected.line);
         }
+    }
 
-        ASSERT_EQ(output, solution);
+    TEST(MonteCarlo, FindsMateInOne) {
+        auto [board, whiteToMove] = Utils::parseFEN("6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1");
+        MonteCarlo::GameTree tree{1 << 16};
+        tree.setPosition(board, whiteToMove);
+        tree.search(20000);
+
+        ASSERT_EQ(Utils::moveNameShortNotation(tree.bestMove()), "Ra8");
+        ASSERT_LE(tree.size(), tree.capacity());
     }
 
-//TEST_P(EngineTest, MonteCarlo) {
-//    auto [fen, solution] = GetParam();
-//    auto [board, state] = Utils::loadFEN(fen);
-//
-//    Move move = MCTS(board, state, 1000000);
-//    std::string output = Utils::moveNameShortNotation(move);
-//
-//    ASSERT_EQ(output, solution);
-//}
+    TEST(MonteCarlo, ReusesSubtree) {
+        MonteCarlo::GameTree tree{1 << 16};
+        tree.setPosition(STARTBOARD, true);
+        tree.search(5000);
+
+        Move best = tree.bestMove();
+        uint32_t visits = tree.rootStats().front().visits;
+        ASSERT_TRUE(tree.advance(best));
+        ASSERT_EQ(tree.rootVisits(), visits);
+
+        tree.search(1000);
+        ASSERT_EQ(tree.rootVisits(), visits + 1000);
+    }
+
+    TEST(MonteCarlo, PlayoutEndings) {
+        MonteCarlo::PlayoutKernel kernel{42};
+        auto [mated, matedWhite] = Utils::parseFEN("R5k1/5ppp/8/8/8/8/8/6K1 b - - 0 1");
+        ASSERT_EQ(kernel.run(mated, matedWhite), MonteCarlo::RESULT_Loss);
+
+        auto [stalemate, stalemateWhite] = Utils::parseFEN("k7/8/1Q6/8/8/8/8/7K b - - 0 1");
+        ASSERT_EQ(kernel.run(stalemate, stalemateWhite), MonteCarlo::RESULT_Draw);
+
+        auto [minor, minorWhite] = Utils::parseFEN("k7/8/8/8/8/8/8/5N1K w - - 0 1");
+        ASSERT_EQ(kernel.run(minor, minorWhite), MonteCarlo::RESULT_Draw);
+        ASSERT_EQ(kernel.pliesPlayed(), 0);
+
+        // the clock of the position counts: one more quiet move ends the game
+        auto [late, lateWhite] = Utils::parseFEN("k7/r7/8/8/8/8/7R/7K w - - 99 80");
+        const uint64_t pliesBefore = kernel.pliesPlayed();
+        ASSERT_EQ(kernel.run(late, lateWhite), MonteCarlo::RESULT_Draw);
+        ASSERT_LE(kernel.pliesPlayed() - pliesBefore, 1);
+
+        // random rook endings mostly end through the 50 move rule long before the ply limit
+        auto [rooks, rooksWhite] = Utils::parseFEN("k7/r7/8/8/8/8/7R/7K w - - 0 1");
+        auto stats = kernel.runBatch(rooks, rooksWhite, 200);
+        ASSERT_EQ(stats.games(), 200);
+        ASSERT_LT(stats.plies, 200ull * MonteCarlo::MAX_PLAYOUT_PLIES);
+    }
+
+    TEST(MonteCarlo, SimulatesGames) {
+        DoryUtils::initialize();
+        auto [board, whiteToMove] = Utils::parseFEN("6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1");
+
+        auto stats = MonteCarlo::runSimulations(board, whiteToMove, 8, 2, 2, 1.0);
+        ASSERT_EQ(stats.whiteWins, 8);
+        ASSERT_EQ(stats.plies, 8);
+    }
+
+    TEST(MonteCarlo, SharedTreeThreads) {
+        auto [board, whiteToMove] = Utils::parseFEN("6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1");
+        MonteCarlo::GameTree tree{1 << 16};
+        tree.setPosition(board, whiteToMove);
+        tree.search(20000, 4);
+
+        // virtual losses are fully reverted once all threads are done
+        ASSERT_EQ(tree.rootVisits(), 20000);
+        uint32_t childVisits = 0;
+        for (auto& stats: tree.rootStats()) childVisits += stats.visits;
+        ASSERT_EQ(childVisits, 20000);
+        ASSERT_EQ(Utils::moveNameShortNotation(tree.bestMove()), "Ra8");
+    }
+
+    TEST(Tablebases, ProbesInSearch) {
+        auto [board, whiteToMove] = Utils::parseFEN("8/8/8/4k3/8/2n5/3BK3/8 w - - 0 1");
+        ASSERT_EQ(Tablebases::materialKey(board), Tablebases::materialKey("KNvKB", false));
+        ASSERT_EQ(Tablebases::probeWDL(board, whiteToMove), Tablebases::WDL_Unknown);
+
+        // capturing the knight leaves a drawn KBvK
+        Engine engine{};
+        engine.setTablebaseOptions({1, 3});
+        engine.searchDepth(board, 3, whiteToMove);
+        ASSERT_GT(engine.tbHits(), 0);
+        ASSERT_LE(engine.tbHits(), engine.tbProbes());
+
+        auto [drawn, white] = Utils::parseFEN("8/8/8/4k3/8/8/3BK3/8 w - - 0 1");
+        ASSERT_EQ(engine.searchDepth(drawn, 4, white).eval, 0);
+
+        engine.setTablebaseOptions({1, 0});
+        engine.searchDepth(drawn, 4, white);
+        ASSERT_EQ(engine.tbProbes(), 0);
+    }
+
+    TEST(Bitbases, KPK) {
+        Bitbases::initKPK();
+        ASSERT_EQ(Bitbases::detail::store().kpk->sizeBytes(), 24576);
+
+        auto probe = [](std::string_view fen) {
+            auto [board, whiteToMove] = Utils::parseFEN(fen);
+            return Tablebases::probeWDL(board, whiteToMove);
+        };
+        // the king in front of its pawn only wins with the opposition
+        ASSERT_EQ(probe("8/4k3/8/4K3/4P3/8/8/8 w - - 0 1"), Tablebases::WDL_Draw);
+        ASSERT_EQ(probe("8/4k3/8/4K3/4P3/8/8/8 b - - 0 1"), Tablebases::WDL_Loss);
+        ASSERT_EQ(probe("8/8/8/4p3/4k3/8/4K3/8 b - - 0 1"), Tablebases::WDL_Draw);
+        ASSERT_EQ(probe("8/8/8/4p3/4k3/8/4K3/8 w - - 0 1"), Tablebases::WDL_Loss);
+        // rook pawns are drawn once the defending king reaches the corner
+        ASSERT_EQ(probe("k7/8/8/8/P7/8/8/7K w - - 0 1"), Tablebases::WDL_Draw);
+        // the dependencies were generated along the way
+        ASSERT_EQ(probe("8/8/8/4k3/8/8/8/R3K3 w - - 0 1"), Tablebases::WDL_Win);
+        ASSERT_EQ(probe("k7/2Q5/1K6/8/8/8/8/8 b - - 0 1"), Tablebases::WDL_Draw);
+    }
+
+    /**
+     * A Syzygy file of a pawnless table with three pieces in which every value has a code of its own, 'bits' long,
+     * in blocks of 64 bytes. 'values' holds one table per side to move.
+     */
+    std::string syzygyFile(bool dtz, int bits, const uint8_t pieces[3], const std::vector<std::vector<uint8_t>>& values) {
+        const size_t perBlock = 64 * 8 / bits, span = 128;
+        auto put16 = [](std::string& out, size_t v) { out += static_cast<char>(v & 0xFF); out += static_cast<char>(v >> 8); };
+        auto put32 = [&](std::string& out, size_t v) { put16(out, v & 0xFFFF); put16(out, v >> 16); };
+        auto numBlocks = [&](const std::vector<uint8_t>& v) { return (v.size() + perBlock - 1) / perBlock; };
+
+        std::string out(reinterpret_cast<const char*>(dtz ? Syzygy::detail::DTZ_MAGIC : Syzygy::detail::WDL_MAGIC), 4);
+        out += '\1';    // split into sides to move, no pawns
+        out += '\0';    // the three pieces are encoded together first
+        for (int k = 0; k < 3; k++) out += static_cast<char>(pieces[k] | pieces[k] << 4);
+        out += '\0';
+        for (auto& v: values) {
+            out += static_cast<char>(dtz ? Syzygy::detail::FLAG_WinPlies : 0);
+            out += '\6';    // 64 byte blocks
+            out += '\7';    // a sparse index entry every 128 values
+            out += '\0';
+            put32(out, numBlocks(v));
+            out += {static_cast<char>(bits), static_cast<char>(bits)};
+            put16(out, 0);
+            put16(out, size_t{1} << bits);
+            for (int sym = 0; sym < 1 << bits; sym++) out += {static_cast<char>(sym), '\xF0', '\xFF'};
+        }
+        for (auto& v: values) {
+            for (size_t p = span / 2; p - span / 2 < v.size(); p += span) {
+                const size_t block = std::min(p / perBlock, numBlocks(v) - 1);
+                put32(out, block);
+                put16(out, p - block * perBlock);
+            }
+        }
+        for (auto& v: values) {
+            for (size_t b = 0; b < numBlocks(v); b++) put16(out, std::min(perBlock, v.size() - b * perBlock) - 1);
+        }
+        for (auto& v: values) {
+            out.resize((out.size() + 63) & ~size_t{63}, '\0');
+            std::string data(numBlocks(v) * 64, '\0');
+            for (size_t i = 0; i < v.size(); i++) {
+                for (size_t j = 0, bit = (i / perBlock) * 512 + (i % perBlock) * bits; j < static_cast<size_t>(bits); j++, bit++) {
+                    if ((v[i] >> (bits - 1 - j)) & 1) data[bit / 8] = static_cast<char>(data[bit / 8] | (0x80 >> (bit % 8)));
+                }
+            }
+            out += data;
+        }
+        return out + std::string(8, '\0');
+    }
+
+    /// Location of a position in a table listing its pieces in the order of 'pieces', as a file header would
+    Syzygy::detail::Location syzygyLocation(std::string_view signature, std::vector<uint8_t> pieces, std::string_view fen) {
+        auto table = Syzygy::detail::makeTable(signature);
+        const int order[2] = {0, 0xF};
+        for (int f = 0; f < 4; f++) {
+            for (Syzygy::detail::PairsData* d: {&table->wdl[0][f], &table->wdl[1][f]}) {
+                std::copy(pieces.begin(), pieces.end(), d->pieces);
+                Syzygy::detail::setGroups(*table, *d, order, f);
+            }
+        }
+        auto [board, whiteToMove] = Utils::parseFEN(fen);
+        return Syzygy::detail::locate<false>(*table, board, whiteToMove);
+    }
+
+    TEST(Syzygy, EncodesReferenceIndices) {
+        // worked out by hand from the encoding of the Syzygy probing code, pieces in file order
+        const std::vector<uint8_t> krk{6, 4, 14};
+        // b1 is the first square of the a1-d1-d4 triangle: (0 * 63 + e4 - 1) * 62 + h8 - 2
+        ASSERT_EQ(syzygyLocation("KRvK", krk, "7k/8/8/8/4R3/8/8/1K6 w - - 0 1").index, 1735);
+        // mirrored to Kc3 Ra7 Kh8, then across the diagonal to Rg1: (6 * 63 + 2 * 28 + 5) * 62 + 63 - 2
+        ASSERT_EQ(syzygyLocation("KRvK", krk, "8/8/5K2/8/8/8/7R/k7 w - - 0 1").index, 27279);
+        // black as the strong side is looked up with colors swapped, in the table of the strong side to move
+        auto swapped = syzygyLocation("KRvK", krk, "1k6/8/8/4r3/8/8/8/7K b - - 0 1");
+        ASSERT_EQ(swapped.index, 1735);
+        ASSERT_EQ(swapped.side, 0);
+        ASSERT_EQ(syzygyLocation("KRvK", krk, "7k/8/8/8/4R3/8/8/1K6 b - - 0 1").side, 1);
+
+        // the kings take one of 462 codes, Kb1 Kd1 the first, then the rooks C(54, 1) + C(61, 2) times 462
+        ASSERT_EQ(syzygyLocation("KRRvK", {6, 14, 4, 4}, "R6R/8/8/8/8/8/8/1K1k4 w - - 0 1").index, 870408);
+
+        // e4 is mirrored to d4, the third rank of the d file, then Kd1 is 3 of 63 and Ke8 58 of 62 squares
+        auto pawn = syzygyLocation("KPvK", {1, 6, 14}, "3k4/8/8/8/4P3/8/8/4K3 w - - 0 1");
+        ASSERT_EQ(pawn.file, 3);
+        ASSERT_EQ(pawn.index, 2 + 3 * 6 + 58 * 6 * 63);
+        // a2 leads, b3 has pawn code 33, the 252 pawn placements of the a file multiply the kings
+        ASSERT_EQ(syzygyLocation("KPPvK", {1, 1, 6, 14}, "7k/8/8/8/8/1P6/P7/7K w - - 0 1").index,
+                  33 + 7 * 252 + 60 * 252 * 62);
+    }
+
+    TEST(Syzygy, ProbesTables) {
+        const std::filesystem::path dir = std::filesystem::path(::testing::TempDir()) / "dory_syzygy";
+        std::filesystem::create_directories(dir);
+        ASSERT_EQ(Syzygy::init((dir / "missing").string()), 0);
+        auto [rookEnding, rookWhite] = Utils::parseFEN("8/8/8/4k3/8/8/8/R3K3 w - - 0 1");
+        const Tablebases::WDL before = Tablebases::probeWDL(rookEnding, rookWhite);
+        const int maxPiecesBefore = Tablebases::maxPieces();
+        // the registry is shared with the other tests, unload the tables also when an assertion fails
+        struct Unload { ~Unload() { Syzygy::init(""); } } unload;
+
+        // true results and distances to mate of KRvK, no move but mate zeroes the 50 move counter
+        Bitbases::Table krk{Tablebases::materialKey("KRvK")};
+        Bitbases::Generator{krk}.run(1);
+        std::vector<int> dtm(krk.numEntries, -1);
+        std::vector<bool> legal(krk.numEntries);
+        Board board;
+        bool whiteToMove;
+        MoveCollectors::MoveList list;
+        for (size_t ix = 0; ix < krk.numEntries; ix++) {
+            legal[ix] = krk.setup(ix, board, whiteToMove);
+            if (!legal[ix] || krk.get(ix) == Bitbases::Draw) continue;
+            list.generate(board, whiteToMove);
+            if (list.count == 0) dtm[ix] = 0;
+        }
+        for (int ply = 1, changed = 1; changed; ply++) {
+            changed = 0;
+            for (size_t ix = 0; ix < krk.numEntries; ix++) {
+                if (!legal[ix] || dtm[ix] >= 0 || krk.get(ix) == Bitbases::Draw) continue;
+                krk.place(ix, board, whiteToMove);
+                list.generate(board, whiteToMove);
+                int longest = 0;
+                bool found = false, allResolved = true;
+                for (const Move& move: list) {
+                    const Board child = whiteToMove ? board.fork<true>(move) : board.fork<false>(move);
+                    const int d = Tablebases::materialKey(child) == krk.key ? dtm[krk.index(child, !whiteToMove)] : -1;
+                    found |= d == ply - 1;
+                    allResolved &= d >= 0;
+                    longest = std::max(longest, d);
+                }
+                if (krk.get(ix) == Bitbases::Win ? found : allResolved && longest == ply - 1) {
+                    dtm[ix] = ply;
+                    changed++;
+                }
+            }
+        }
+
+        // files of both orientations, every position of a table index must have the same value
+        auto layout = Syzygy::detail::makeTable("KRvK");
+        const uint8_t pieces[3] = {6, 4, 14};
+        const int order[2] = {0, 0xF};
+        for (Syzygy::detail::PairsData* d: {&layout->wdl[0][0], &layout->wdl[1][0]}) {
+            std::copy(pieces, pieces + 3, d->pieces);
+            Syzygy::detail::setGroups(*layout, *d, order, 0);
+        }
+        ASSERT_EQ(layout->wdl[0][0].size(), 31332);
+        std::vector<std::vector<uint8_t>> wdl(2, std::vector<uint8_t>(31332, 2)), dtz(1, std::vector<uint8_t>(31332, 0));
+        std::vector<std::vector<bool>> seen(2, std::vector<bool>(31332));
+        for (size_t ix = 0; ix < krk.numEntries; ix++) {
+            if (!legal[ix]) continue;
+            krk.setup(ix, board, whiteToMove);
+            const auto location = Syzygy::detail::locate<false>(*layout, board, whiteToMove);
+            const uint8_t value = 2 + 2 * Bitbases::toWDL(krk.get(ix));
+            if (seen[location.side][location.index]) {
+                ASSERT_EQ(wdl[location.side][location.index], value);
+            }
+            seen[location.side][location.index] = true;
+            wdl[location.side][location.index] = value;
+            if (location.side == 0 && dtm[ix] > 0) dtz[0][location.index] = static_cast<uint8_t>(dtm[ix] - 1);
+        }
+        std::ofstream(dir / "KRvK.rtbw", std::ios::binary) << syzygyFile(false, 3, pieces, wdl);
+        std::ofstream(dir / "KRvK.rtbz", std::ios::binary) << syzygyFile(true, 5, pieces, dtz);
+
+        ASSERT_EQ(Syzygy::init((dir / "missing").string() + ":" + dir.string()), 1);
+        ASSERT_EQ(Syzygy::maxPieces(), 3);
+        Syzygy::ProbeState state;
+        for (size_t ix = 0; ix < krk.numEntries; ix++) {
+            if (!legal[ix]) continue;
+            krk.setup(ix, board, whiteToMove);
+            const Tablebases::WDL expected = Bitbases::toWDL(krk.get(ix));
+            ASSERT_EQ(Tablebases::probeWDL(board, whiteToMove), expected);
+            ASSERT_EQ(Tablebases::probeWDL(Bitbases::flipped(board), !whiteToMove), expected);
+            if (expected == Tablebases::WDL_Draw || ix % 7) continue;
+            // black to move is not stored in the DTZ file and looks one move ahead
+            const int dtzValue = whiteToMove ? Syzygy::probeDTZ<true>(board, state) : Syzygy::probeDTZ<false>(board, state);
+            ASSERT_EQ(state == Syzygy::PROBE_ChangeSide || state == Syzygy::PROBE_Ok, true);
+            ASSERT_EQ(dtzValue, expected == Tablebases::WDL_Win ? dtm[ix] : -std::max(dtm[ix], 1));
+        }
+
+        // both sides keep the moves with the best distance, so the game takes exactly as long as the mate
+        auto [game, white] = Utils::parseFEN("8/8/8/4k3/8/8/8/R3K3 w - - 0 1");
+        const int plies = dtm[krk.index(game, white)];
+        ASSERT_GT(plies, 20);
+        Engine engine{};
+        engine.setTablebaseOptions({1, 3});
+        for (int ply = 0; ply < plies; ply++, white = !white) {
+            const Result result = engine.searchDepth(game, 1, white);
+            ASSERT_FALSE(result.line.empty());
+            game = white ? game.fork<true>(result.line.back()) : game.fork<false>(result.line.back());
+            ASSERT_EQ(dtm[krk.index(game, !white)], plies - ply - 1);
+        }
+        ASSERT_GT(engine.tbHits(), 0);
+
+        // unloading hands the material back to the table registered before
+        ASSERT_EQ(Syzygy::init(""), 0);
+        ASSERT_EQ(Tablebases::probeWDL(rookEnding, rookWhite), before);
+        ASSERT_EQ(Tablebases::maxPieces(), maxPiecesBefore);
+    }
+
+    TEST(Draws, RepetitionWindow) {
+        RepetitionTable table;
+        const uint64_t history[] = {1, 2, 3, 4, 1, 2, 3, 4};
+        table.setGameHistory(history);
+        // one occurrence in the game is not a repetition yet, two are
+        ASSERT_FALSE(table.check(3, 10));
+        ASSERT_TRUE(table.check(1, 10));
+        // only positions since the last capture or pawn move count, with the same side to move
+        ASSERT_FALSE(table.check(1, 7));
+        ASSERT_FALSE(table.check(2, 10));
+
+        for (uint64_t h: {5, 6, 7, 8}) table.push(h);
+        ASSERT_TRUE(table.check(5, 4));
+        table.reset();
+        ASSERT_FALSE(table.check(5, 4));
+        ASSERT_TRUE(table.check(1, 10));
+    }
+
+    TEST(Draws, RepetitionFilter) {
+        // the filter buckets by the top bits of the hash, so these hashes land in different buckets
+        auto h = [](uint64_t i) { return i << 54; };
+        RepetitionTable table;
+        const uint64_t history[] = {h(7)};
+        table.setGameHistory(history);
+        for (uint64_t i: {1, 2, 3, 4}) table.push(h(i));
+
+        ASSERT_TRUE(table.check(h(1), 10));
+        ASSERT_FALSE(table.check(h(5), 10));
+        ASSERT_FALSE(table.check(h(1) | 1, 10));   // same bucket, different position
+#ifdef DORY_REPETITION_FILTER
+        ASSERT_EQ(table.filterCount(h(5)), 0);
+        ASSERT_EQ(table.filterCount(h(1) | 1), 1);
+#endif
+
+        for (int i = 0; i < 4; i++) table.pop();
+        ASSERT_FALSE(table.check(h(1), 10));
+#ifdef DORY_REPETITION_FILTER
+        for (uint64_t i: {1, 2, 3, 4}) ASSERT_EQ(table.filterCount(h(i)), 0);
+        ASSERT_EQ(table.filterCount(h(7)), 1);
+#endif
+
+        table.push(h(1));
+        table.reset();
+#ifdef DORY_REPETITION_FILTER
+        ASSERT_EQ(table.filterCount(h(1)), 0);
+        ASSERT_EQ(table.filterCount(h(7)), 1);
+#endif
+    }
+
+    TEST(Draws, FiftyMovesAndMaterial) {
+        Engine engine{};
+        auto [rook, white] = Utils::parseFEN("8/8/8/4k3/8/8/8/K6R w - - 99 1");
+        ASSERT_EQ(rook.halfmoveClock, 99);
+        ASSERT_EQ(engine.searchDepth(rook, 3, white).eval, 0);
+
+        // mate with the 100th half-move is still mate
+        auto [mate, w100] = Utils::parseFEN("6k1/5ppp/8/8/8/8/8/R5K1 w - - 99 1");
+        ASSERT_EQ(engine.searchDepth(mate, 2, w100).eval, INF - 1);
+
+        auto [bishops, w] = Utils::parseFEN("8/8/8/2b1k3/8/8/3BK3/8 w - - 0 1");
+        ASSERT_TRUE(bishops.insufficientMaterial());
+        ASSERT_EQ(engine.searchDepth(bishops, 3, w).eval, 0);
+        ASSERT_FALSE(Utils::parseFEN("8/8/8/1b2k3/8/8/3BK3/8 w - - 0 1").first.insufficientMaterial());
+    }
+
+    TEST(Search, CollectsStatistics) {
+        Engine engine{};
+        Board board = STARTBOARD;
+        engine.searchDepth(board, 4, true);
+
+        const Search::SearchStats& stats = engine.searchStats();
+        ASSERT_EQ(stats.iterations.size(), 4);
+        const Search::IterationStats total = stats.total();
+        ASSERT_TRUE(total.completed);
+        ASSERT_EQ(total.nodes, engine.nodesSearched());
+        if constexpr (Search::COLLECT_STATS) {
+            ASSERT_GT(total.betaCutoffs, 0);
+            ASSERT_LE(total.firstMoveCutoffs, total.betaCutoffs);
+            ASSERT_LE(total.qnodes, total.nodes);
+            ASSERT_LE(total.ttCutoffs, total.ttHits);
+            ASSERT_LE(total.ttHits, total.ttProbes);
+        }
+        ASSERT_GT(stats.branchingFactor(), 1);
+        ASSERT_EQ(engine.searchStatsJSON().rfind(R"({"enabled":)", 0), 0);
+    }
+
+    TEST(Search, ReportsProgress) {
+        Engine engine{};
+        auto [board, whiteToMove] = Utils::parseFEN("6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1");
+        std::stringstream uci, json;
+
+        Search::UciReporter uciReporter{uci};
+        engine.setReporter(uciReporter);
+        engine.searchDepth(board, 2, whiteToMove);
+        std::string line;
+        std::getline(uci, line);
+        ASSERT_EQ(line.rfind("info depth 1 score mate 1 nodes ", 0), 0) << line;
+        ASSERT_TRUE(line.ends_with(" pv a1a8")) << line;
+
+        Search::JsonReporter jsonReporter{json};
+        engine.setReporter(jsonReporter);
+        engine.searchDepth(board, 1, whiteToMove);
+        std::getline(json, line);
+        ASSERT_EQ(line.rfind(R"({"depth":1,"mate":1,"nodes":)", 0), 0) << line;
+        ASSERT_TRUE(line.ends_with(R"("pv":"a1a8"})")) << line;
+    }
+
+    TEST(Search, BenchSignatureIsDeterministic) {
+        Engine engine{};
+        const uint64_t single = engine.bench(3, 1).nodes;
+        ASSERT_GT(single, 0);
+        ASSERT_EQ(engine.bench(3, 2).nodes, single);
+        engine.setHashSize(1);
+        ASSERT_EQ(engine.bench(3, 1).nodes, single);
+    }
+
+    TEST(Search, TracesTree) {
+        Engine engine{};
+        Board board = STARTBOARD;
+        Search::SearchTrace trace{{.maxPly = 2, .sampleRate = 4}};
+        engine.setTrace(&trace);
+        engine.searchDepth(board, 4, true);
+        const uint64_t nodes = engine.nodesSearched();
+        engine.setTrace(nullptr);
+
+        uint64_t rootNodes{0};
+        size_t rootMoves{0};
+        for (const Search::TraceRecord& r: trace.records()) {
+            ASSERT_LE(r.ply, 2);
+            ASSERT_GE(r.iteration, 1);
+            if (r.iteration == 4 && r.ply == 0) {
+                rootNodes += r.nodes;
+                rootMoves++;
+            }
+        }
+        ASSERT_GE(rootMoves, 20);
+        ASSERT_LE(rootNodes, nodes);
+
+        const std::string path = (std::filesystem::temp_directory_path() / "dory_trace_test.bin").string();
+        ASSERT_TRUE(trace.save(path));
+        Search::SearchTrace loaded;
+        ASSERT_TRUE(loaded.load(path));
+        ASSERT_EQ(loaded.records().size(), trace.records().size());
+        ASSERT_EQ(loaded.traceOptions().sampleRate, 4);
+        ASSERT_EQ(std::memcmp(loaded.records().data(), trace.records().data(),
+                              trace.records().size() * sizeof(Search::TraceRecord)), 0);
+        std::filesystem::remove(path);
+    }
 
     INSTANTIATE_TEST_SUITE_P(
             Puzzles2000,
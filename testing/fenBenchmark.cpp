@@ -0,0 +1,110 @@
+#include <fstream>
+#include <iostream>
+
+#include "../src/dory.h"
+
+/**
+ * Microbenchmark for FEN parsing and writing.
+ *
+ * Loads the positions of the given EPD/FEN files, then repeatedly parses every FEN and writes every board back.
+ * Each written FEN is parsed again to check that the round trip reproduces the board.
+ *
+ * Usage: ./fenBench [rounds] [files...]
+ */
+namespace Dory::Testing {
+
+    std::vector<std::string> loadFENs(const std::string& path) {
+        std::vector<std::string> fens;
+        std::ifstream file(path);
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.size() >= 3 && line.compare(0, 3, "\xEF\xBB\xBF") == 0) line.erase(0, 3);  // UTF-8 BOM
+            line = line.substr(0, line.find(';'));
+            while (!line.empty() && std::isspace(static_cast<unsigned char>(line.back()))) line.pop_back();
+            if (!line.empty() && line.front() != '#') fens.push_back(line);
+        }
+        return fens;
+    }
+
+    template<typename F>
+    double nanosPerCall(size_t calls, F&& f) {
+        Timer t;
+        t.start();
+        f();
+        return static_cast<double>(t.timeNanos()) / static_cast<double>(calls);
+    }
+
+    int runFENBenchmark(const std::vector<std::string>& fens, int rounds) {
+        // only valid positions are written back
+        std::vector<Board> boards;
+        std::vector<bool> sides;
+        size_t invalid = 0;
+        for (const std::string& fen: fens) {
+            Board board;
+            bool white{true};
+            if (Utils::parseFEN(fen, board, white)) {
+                invalid++;
+                continue;
+            }
+            boards.push_back(board);
+            sides.push_back(white);
+        }
+
+        const size_t calls = fens.size() * rounds;
+        uint64_t checksum = 0;
+
+        double parseNs = nanosPerCall(calls, [&]() {
+            Board board;
+            bool white{true};
+            for (int r = 0; r < rounds; r++) {
+                for (const std::string& fen: fens) {
+                    Utils::parseFEN(fen, board, white);
+                    checksum += board.occ() + white;
+                }
+            }
+        });
+
+        char buffer[Utils::MAX_FEN_LENGTH];
+        double writeNs = nanosPerCall(boards.size() * rounds, [&]() {
+            for (int r = 0; r < rounds; r++) {
+                for (size_t i = 0; i < boards.size(); i++) {
+                    checksum += Utils::toFEN(boards[i], sides[i], buffer);
+                }
+            }
+        });
+
+        size_t mismatches = 0;
+        for (size_t i = 0; i < boards.size(); i++) {
+            Board board;
+            bool white{true};
+            std::string_view written{buffer, Utils::toFEN(boards[i], sides[i], buffer)};
+            if (Utils::parseFEN(written, board, white) || !(board == boards[i]) || white != sides[i]) mismatches++;
+        }
+
+        std::cout << fens.size() << " positions (" << invalid << " invalid), " << rounds << " rounds  [checksum "
+                  << (checksum & 0xffff) << "]\n";
+        std::cout << "parseFEN:\t" << parseNs << " ns/FEN\t\t(" << 1000 / parseNs << " M FENs/s)\n";
+        std::cout << "toFEN:\t\t" << writeNs << " ns/FEN\t\t(" << 1000 / writeNs << " M FENs/s)\n";
+        std::cout << mismatches << " round trip mismatches" << std::endl;
+        return mismatches ? 1 : 0;
+    }
+
+} // namespace Dory::Testing
+
+int main(int argc, char* argv[]) {
+    int rounds = argc > 1 ? static_cast<int>(std::strtol(argv[1], nullptr, 10)) : 100;
+    std::vector<std::string> paths{"../resources/perftsuite.epd", "../resources/equalPositions.txt"};
+    if (argc > 2) paths.assign(argv + 2, argv + argc);
+
+    std::vector<std::string> fens;
+    for (const std::string& path: paths) {
+        auto loaded = Dory::Testing::loadFENs(path);
+        fens.insert(fens.end(), loaded.begin(), loaded.end());
+    }
+    if (fens.empty()) {
+        std::cerr << "No positions found" << std::endl;
+        return 2;
+    }
+
+    return Dory::Testing::runFENBenchmark(fens, std::max(rounds, 1));
+}
@@ -99,6 +99,223 @@ namespace Dory::Testing {
         );
     }
 
+#ifdef DORY_MAILBOX
+    /**
+     * Walks the game tree and checks that makeMove, unmakeMove and fork keep the mailbox in sync with the bitboards.
+     * Every depth needs its own collector type, as the move generator state is shared between instances of one type.
+     */
+    template<int depth>
+    struct MailboxChecker {
+        template<bool whiteToMove, Piece_t piece, Flag_t flags = MOVEFLAG_Silent>
+        void nextMove(Board& board, BB from, BB to) {
+            const Board original = board;
+            const Board forked = board.fork<whiteToMove, piece, flags>(from, to);
+
+            RestoreInfo ri = board.makeMove<whiteToMove, piece, flags>(from, to);
+            Board rebuilt = board;
+            rebuilt.fillMailbox();
+            ASSERT_EQ(board, rebuilt);
+            ASSERT_EQ(board, forked);
+
+            if constexpr (depth > 1) {
+                MailboxChecker<depth - 1> next;
+                MoveCollectors::generateMoves<MailboxChecker<depth - 1>, !whiteToMove>(&next, board);
+            }
+
+            board.unmakeMove<whiteToMove, piece, flags>(from, to, ri);
+            ASSERT_EQ(board, original);
+        }
+    };
+
+    template<int depth>
+    void checkMailbox(std::string_view fen) {
+        auto [board, whiteToMove] = Utils::parseFEN(fen);
+        MailboxChecker<depth> checker;
+        if (whiteToMove) MoveCollectors::generateMoves<MailboxChecker<depth>, true>(&checker, board);
+        else MoveCollectors::generateMoves<MailboxChecker<depth>, false>(&checker, board);
+    }
+
+    TEST(Mailbox, StaysInSync) {
+        DoryUtils::initialize();
+        checkMailbox<3>("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -");
+        checkMailbox<3>("r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1");
+        checkMailbox<3>("r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1");
+        checkMailbox<4>("8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1");
+    }
+
+    TEST(Mailbox, DefaultBoardIsEmpty) {
+        Board board;
+        for (int sq = 0; sq < 64; sq++) ASSERT_EQ(board.pieceAt(sq), PIECE_None);
+        ASSERT_EQ(board.mailbox, EMPTY_MAILBOX);
+    }
+#endif
+
+    TEST(FEN, RoundTrip) {
+        for (std::string_view fen: {
+                "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+                "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+                "r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1",
+                "8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1",
+                "rnbqkb1r/ppp1pppp/5n2/3pP3/8/8/PPPP1PPP/RNBQKBNR w Kq d6 0 1",
+                "8/5k2/8/8/3R4/8/5K2/8 b - - 99 1",
+                "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3"}) {
+            Board board;
+            bool whiteToMove;
+            unsigned fullmoveNumber;
+            ASSERT_FALSE(Utils::parseFEN(fen, board, whiteToMove, fullmoveNumber));
+            ASSERT_EQ(Utils::toFEN(board, whiteToMove, fullmoveNumber), fen);
+        }
+        // without a fullmove number the field is left out instead of guessed
+        auto [clockOnly, white] = Utils::parseFEN("8/5k2/8/8/3R4/8/5K2/8 b - - 99");
+        ASSERT_EQ(Utils::toFEN(clockOnly, white), "8/5k2/8/8/3R4/8/5K2/8 b - - 99");
+
+        auto [board, whiteToMove] = Utils::parseFEN("startpos");
+        ASSERT_EQ(board, STARTBOARD);
+        ASSERT_TRUE(whiteToMove);
+    }
+
+    TEST(FEN, ReportsErrors) {
+        Board board = STARTBOARD;
+        bool whiteToMove = true;
+        const std::pair<std::string_view, size_t> invalid[] = {
+                {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP w KQkq - 0 1", 34},
+                {"rnbqkbnr/pppppppp/9/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 18},
+                {"rnbqkbnr/ppppxppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 13},
+                {"rnbq1bnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 43},
+                {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR x KQkq - 0 1", 44},
+                {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQxq - 0 1", 48},
+                {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq e4 0 1", 51},
+                {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w", 45},
+        };
+        for (auto [fen, offset]: invalid) {
+            Utils::FENError error = Utils::parseFEN(fen, board, whiteToMove);
+            ASSERT_TRUE(error) << fen;
+            ASSERT_EQ(error.offset, offset) << fen << ": " << error.message;
+        }
+        ASSERT_EQ(board, STARTBOARD);
+        ASSERT_THROW(Utils::parseFEN("8/8/8 w - -"), std::invalid_argument);
+    }
+
+    TEST(PGN, ParsesSAN) {
+        auto [board, whiteToMove] = Utils::parseFEN("4k3/1P6/8/8/8/8/8/N1N1K2R w K - 0 1");
+        ASSERT_EQ(Utils::parseSAN(board, whiteToMove, "Nb3"), NULLMOVE);
+        ASSERT_EQ(Utils::parseSAN(board, whiteToMove, "Nab3").fromIndex, 0);
+        ASSERT_EQ(Utils::parseSAN(board, whiteToMove, "N1b3"), NULLMOVE);
+        ASSERT_EQ(Utils::parseSAN(board, whiteToMove, "O-O+").flags, MOVEFLAG_ShortCastling);
+        ASSERT_EQ(Utils::parseSAN(board, whiteToMove, "b8=N").flags, MOVEFLAG_PromoteKnight);
+        ASSERT_EQ(Utils::parseSAN(board, whiteToMove, "b8Q!").flags, MOVEFLAG_PromoteQueen);
+        ASSERT_EQ(Utils::parseSAN(board, whiteToMove, "b8"), NULLMOVE);
+        ASSERT_EQ(Utils::parseSAN(board, whiteToMove, "Ke3"), NULLMOVE);
+    }
+
+    TEST(PGN, WritesSAN) {
+        auto [board, whiteToMove] = Utils::parseFEN("r3k2r/1P6/8/N2pP3/8/8/8/N1N1K2R w Kkq d6 0 1");
+        const std::pair<std::string_view, std::string_view> moves[] = {
+                {"a1b3", "Na1b3"}, {"c1b3", "Ncb3"}, {"a5b3", "N5b3"}, {"c1d3", "Nd3"}, {"e5d6", "exd6"},
+                {"e1g1", "O-O"}, {"b7a8q", "bxa8=Q+"}, {"b7b8n", "b8=N"}, {"h1h8", "Rxh8+"},
+        };
+        for (auto [coordinates, san]: moves) {
+            Move move = Utils::parseMove(board, whiteToMove, coordinates);
+            ASSERT_EQ(Utils::toSAN(board, whiteToMove, move), san) << coordinates;
+            ASSERT_EQ(Utils::parseSAN(board, whiteToMove, san), move) << san;
+        }
+
+        auto [mate, white] = Utils::parseFEN("6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1");
+        std::vector<Move> line{Utils::parseMove(mate, white, "a1a8")};
+        ASSERT_EQ(Utils::lineToSAN(mate, white, line), "Ra8#");
+    }
+
+    TEST(PGN, ReplaysGames) {
+        const std::string_view pgn =
+                "% exported by hand\n"
+                "[Event \"Casual\"]\n[White \"A\"]\n[Black \"B\"]\n[Result \"1-0\"]\n\n"
+                "1. e4 {open game} e5 2. Nf3 Nc6 (2... d6 3. d4 (3. Bc4) exd4) 3. Bc4 $1 Bc5 4. O-O Nf6\n"
+                "5. d4 exd4 6. e5 d5 7. exd6 ; en passant\n7... Qxd6 1-0\n\n"
+                "[Event \"Ending\"]\n[FEN \"8/P6k/8/8/8/8/8/K7 w - - 0 1\"]\n\n1. a8=Q Kg6 2. Qa6+ Kf5 *\n\n"
+                "[Event \"Broken\"]\n\n1. e4 e5 2. Ke3 Nc6 0-1\n\n"
+                "[Event \"Unfinished\"]\n\n1.d4 d5 2.c4\n";
+
+        Utils::PGNReader reader{pgn};
+        Utils::PGNGame game;
+        std::vector<std::string> finalPositions;
+        std::vector<size_t> moveCounts;
+        while (reader.next(game)) {
+            Board board = game.startBoard;
+            bool whiteToMove = game.startWhite;
+            game.replay([&](const Board&, bool, Move move) {
+                board.makeMove(move, whiteToMove);
+                whiteToMove = !whiteToMove;
+            });
+            finalPositions.push_back(Utils::toFEN(board, whiteToMove));
+            moveCounts.push_back(game.moves.size());
+            ASSERT_EQ(game.error != nullptr, game.tag("Event") == "Broken") << game.tag("Event");
+        }
+
+        ASSERT_EQ(moveCounts, (std::vector<size_t>{14, 4, 2, 3}));
+        ASSERT_EQ(finalPositions[0], "r1b1k2r/ppp2ppp/2nq1n2/2b5/2Bp4/5N2/PPP2PPP/RNBQ1RK1 w kq - 0");
+        ASSERT_EQ(finalPositions[1], "8/8/Q7/5k2/8/8/8/K7 w - - 3");
+        ASSERT_EQ(finalPositions[3], "rnbqkbnr/ppp1pppp/8/3p4/2PP4/8/PP2PPPP/RNBQKBNR b KQkq c3 0");
+
+        std::atomic<size_t> positions{0};
+        ASSERT_EQ(Utils::readPGNParallel(pgn, 3, [&](const Utils::PGNGame& g, size_t) {
+            positions += g.moves.size();
+        }), 4);
+        ASSERT_EQ(positions, 23);
+    }
+
+    TEST(Polyglot, BuildsAndProbesBook) {
+        const std::string_view pgn =
+                "[Event \"1\"]\n\n1. e4 e5 2. Nf3 Nc6 3. Bc4 Nf6 4. O-O 1-0\n\n"
+                "[Event \"2\"]\n\n1. e4 c5 2. Nf3 d6 1/2-1/2\n\n"
+                "[Event \"3\"]\n\n1. d4 d5 2. c4 0-1\n\n"
+                "[Event \"4\"]\n\n1. e4 e5 2. Nf3 Nc6 3. Bc4 Nf6 4. O-O 1/2-1/2\n\n"
+                "[Event \"5\"]\n\n1. c4 *\n";
+        const std::string path = ::testing::TempDir() + "dory_book.bin";
+        ASSERT_EQ(Polyglot::writeBook(pgn, path, 7), 11);
+
+        Polyglot::Book book{path};
+        ASSERT_TRUE(book.isOpen());
+        ASSERT_EQ(book.size(), 11);
+
+        // 1. e4 scored a win and two draws, 1. d4 lost and unfinished games are ignored
+        auto moves = book.probe(STARTBOARD, true);
+        ASSERT_EQ(moves.size(), 1);
+        ASSERT_EQ(Utils::moveFullNotation(moves[0].move), "e2e4");
+        ASSERT_EQ(moves[0].weight, 4);
+
+        Utils::WyRand rng{1};
+        Board board = STARTBOARD;
+        bool whiteToMove = true;
+        for (std::string_view san: {"e4", "e5", "Nf3", "Nc6", "Bc4", "Nf6", "O-O"}) {
+            Move move = book.pick(board, whiteToMove, false, rng);
+            ASSERT_EQ(Utils::toSAN(board, whiteToMove, move), san);
+            board.makeMove(move, whiteToMove);
+            whiteToMove = !whiteToMove;
+        }
+        ASSERT_EQ(book.pick(board, whiteToMove, true, rng), NULLMOVE);
+        ASSERT_EQ(Polyglot::encodeMove(Utils::parseMove(Utils::parseFEN("r3k2r/8/8/8/8/8/8/R3K2R b KQkq - 0 1").first,
+                                                        false, "e8c8")), (60 << 6) | 56);
+    }
+
+    TEST(Polyglot, ReferenceKeys) {
+        // the examples of the Polyglot book format specification
+        const std::pair<std::string_view, uint64_t> positions[] = {
+                {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 0x463b96181691fc9cull},
+                {"rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1", 0x823c9b50fd114196ull},
+                {"rnbqkbnr/ppp1pppp/8/3p4/4P3/8/PPPP1PPP/RNBQKBNR w KQkq d6 0 2", 0x0756b94461c50fb0ull},
+                {"rnbqkbnr/ppp1pppp/8/3pP3/8/8/PPPP1PPP/RNBQKBNR b KQkq - 0 2", 0x662fafb965db29d4ull},
+                {"rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3", 0x22a48b5a8e47ff78ull},
+                {"rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR b kq - 0 3", 0x652a607ca3f242c1ull},
+                {"rnbq1bnr/ppp1pkpp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR w - - 0 4", 0x00fdd303c946bdd9ull},
+                {"rnbqkbnr/p1pppppp/8/8/PpP4P/8/1P1PPPP1/RNBQKBNR b KQkq c3 0 3", 0x3c8123ea7b067637ull},
+                {"rnbqkbnr/p1pppppp/8/8/P6P/R1p5/1P1PPPP1/1NBQKBNR b Kkq - 0 4", 0x5c3f9b829b279560ull}
+        };
+        for (auto& [fen, expected]: positions) {
+            auto [board, whiteToMove] = Utils::parseFEN(fen);
+            ASSERT_EQ(Polyglot::key(board, whiteToMove), expected) << fen;
+        }
+    }
+
     template<int depth>
     void checkSingleDepth(std::string_view fen, uLong expected) {
         DoryUtils::initialize();
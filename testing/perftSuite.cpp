@@ -0,0 +1,188 @@
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+
+#include "../src/dory.h"
+
+/**
+ * Standalone runner for EPD perft suites.
+ *
+ * Every line of the suite has the form
+ *      <FEN> ;D1 <nodes> ;D2 <nodes> ...
+ * The file is streamed in batches, so arbitrarily large suites only ever keep a few positions in memory.
+ * Each position is checked at all listed depths up to the given maximum and the runner reports mismatches
+ * together with per-position and aggregate node rates.
+ *
+ * Usage: ./perftSuite [epd file] [max depth] [threads]
+ */
+namespace Dory::Testing {
+
+    using uLong = unsigned long long;
+
+    struct PerftExpectation {
+        int depth;
+        uLong nodes;
+    };
+
+    struct PerftCase {
+        size_t lineNumber{0};
+        std::string fen;
+        std::vector<PerftExpectation> expected;
+    };
+
+    struct PerftCaseResult {
+        uLong nodes{0};
+        double seconds{0};
+        int deepest{0};
+        std::vector<std::string> mismatches;
+    };
+
+    std::string_view trim(std::string_view str) {
+        while (!str.empty() && std::isspace(static_cast<unsigned char>(str.front()))) str.remove_prefix(1);
+        while (!str.empty() && std::isspace(static_cast<unsigned char>(str.back()))) str.remove_suffix(1);
+        return str;
+    }
+
+    bool parseEPDLine(std::string_view line, PerftCase& pc) {
+        line = trim(line);
+        if (line.empty() || line.front() == '#') return false;
+
+        size_t sep = line.find(';');
+        pc.fen = trim(line.substr(0, sep));
+        pc.expected.clear();
+
+        while (sep != std::string_view::npos) {
+            line.remove_prefix(sep + 1);
+            sep = line.find(';');
+            std::string_view op = trim(line.substr(0, sep));
+            if (op.size() < 2 || op.front() != 'D') continue;
+
+            char* end;
+            std::string opStr{op.substr(1)};
+            long depth = std::strtol(opStr.c_str(), &end, 10);
+            uLong nodes = std::strtoull(end, nullptr, 10);
+            if (depth > 0) pc.expected.push_back({static_cast<int>(depth), nodes});
+        }
+        return true;
+    }
+
+    PerftCaseResult runPerftCase(const PerftCase& pc, int maxDepth) {
+        PerftCaseResult res;
+        auto [board, whiteToMove] = Utils::parseFEN(pc.fen);
+
+        for (const auto& [depth, expected]: pc.expected) {
+            if (depth > maxDepth) continue;
+
+            Timer t;
+            t.start();
+            uLong output = DoryUtils::perftSingleDepth(board, whiteToMove, depth);
+            res.seconds += t.timeSeconds();
+            res.nodes += output;
+            res.deepest = std::max(res.deepest, depth);
+
+            if (output != expected) {
+                std::stringstream ss;
+                ss << "D" << depth << ": expected " << expected << ", got " << output;
+                res.mismatches.push_back(ss.str());
+            }
+        }
+        return res;
+    }
+
+    double mnps(uLong nodes, double seconds) {
+        return seconds > 0 ? (static_cast<double>(nodes) / 1000000) / seconds : 0;
+    }
+
+    int runPerftSuite(std::istream& input, int maxDepth, unsigned int numThreads) {
+        const size_t batchSize = 8 * numThreads;
+        std::vector<PerftCase> batch(batchSize);
+        std::vector<PerftCaseResult> results(batchSize);
+
+        size_t lineNumber{0}, positions{0}, failedPositions{0};
+        uLong totalNodes{0};
+        double cpuSeconds{0};
+        std::string line;
+
+        Timer wall;
+        wall.start();
+
+        bool moreInput = true;
+        while (moreInput) {
+            // Read the next batch of positions
+            size_t batchCount = 0;
+            while (batchCount < batchSize) {
+                if (!std::getline(input, line)) {
+                    moreInput = false;
+                    break;
+                }
+                lineNumber++;
+                if (parseEPDLine(line, batch[batchCount])) {
+                    batch[batchCount].lineNumber = lineNumber;
+                    batchCount++;
+                }
+            }
+
+            // Let all workers pull positions from the batch until it is exhausted
+            std::atomic<size_t> next{0};
+            auto worker = [&]() {
+                for (size_t i = next++; i < batchCount; i = next++) {
+                    results[i] = runPerftCase(batch[i], maxDepth);
+                }
+            };
+
+            std::vector<std::thread> threads;
+            for (unsigned int i = 1; i < numThreads; i++) threads.emplace_back(worker);
+            worker();
+            for (auto& th: threads) th.join();
+
+            // Report in input order
+            for (size_t i = 0; i < batchCount; i++) {
+                const PerftCase& pc = batch[i];
+                const PerftCaseResult& res = results[i];
+                positions++;
+                totalNodes += res.nodes;
+                cpuSeconds += res.seconds;
+
+                std::cout << std::setw(5) << pc.lineNumber << "  " << (res.mismatches.empty() ? "ok  " : "FAIL")
+                          << "  D" << res.deepest << std::setw(12) << res.nodes << " nodes  "
+                          << std::setw(7) << static_cast<long>(res.seconds * 1000) << "ms  "
+                          << std::fixed << std::setprecision(1) << std::setw(7) << mnps(res.nodes, res.seconds)
+                          << " M nps  " << pc.fen << "\n";
+
+                for (const auto& mismatch: res.mismatches) {
+                    std::cout << "          " << mismatch << "\n";
+                }
+                if (!res.mismatches.empty()) failedPositions++;
+            }
+        }
+
+        double wallSeconds = wall.timeSeconds();
+        std::cout << "\n" << positions << " positions, " << failedPositions << " failed\n";
+        std::cout << "Generated " << totalNodes << " nodes in " << static_cast<long>(wallSeconds * 1000)
+                  << "ms using " << numThreads << " thread(s)\n";
+        std::cout << std::setprecision(2) << mnps(totalNodes, wallSeconds) << " M nps (wall), "
+                  << mnps(totalNodes, cpuSeconds) << " M nps per thread" << std::endl;
+
+        return failedPositions == 0 ? 0 : 1;
+    }
+
+} // namespace Dory::Testing
+
+
+int main(int argc, char* argv[]) {
+    std::string path = argc > 1 ? argv[1] : "../resources/perftsuite.epd";
+    int maxDepth = argc > 2 ? static_cast<int>(std::strtol(argv[2], nullptr, 10)) : 5;
+    unsigned int numThreads = argc > 3 ? static_cast<unsigned int>(std::strtoul(argv[3], nullptr, 10)) : 1;
+    if (numThreads == 0) numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Could not open perft suite " << path << std::endl;
+        return 2;
+    }
+
+    DoryUtils::initialize();
+    return Dory::Testing::runPerftSuite(file, maxDepth, numThreads);
+}